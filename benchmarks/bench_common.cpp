@@ -0,0 +1,30 @@
+#include "bench_common.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+constexpr int64_t MAX_ELEMENTS = 100000000;
+constexpr int64_t MAX_LIST_ELEMENTS = 10000000;
+
+void add_counts(benchmark::internal::Benchmark* benchmark, int64_t limit) {
+  if (const char* env = std::getenv("PYAMTRACK_BENCHMARK_MAX_ELEMENTS")) {
+    int64_t value = std::atoll(env);
+    if (value > 0) limit = std::min(limit, value);
+  }
+  for (int64_t n = 1; n <= limit; n *= 10) benchmark->Arg(n);
+}
+
+}  // namespace
+
+void element_counts(benchmark::internal::Benchmark* benchmark) { add_counts(benchmark, MAX_ELEMENTS); }
+
+void list_element_counts(benchmark::internal::Benchmark* benchmark) { add_counts(benchmark, MAX_LIST_ELEMENTS); }
+
+std::vector<double> benchmark_energies(int64_t n) {
+  std::vector<double> energies(static_cast<size_t>(n));
+  for (int64_t i = 0; i < n; ++i) energies[i] = n > 1 ? std::pow(1000.0, static_cast<double>(i) / (n - 1)) : 1.0;
+  return energies;
+}
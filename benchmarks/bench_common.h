@@ -0,0 +1,42 @@
+#ifndef BENCHMARKS_BENCH_COMMON_H
+#define BENCHMARKS_BENCH_COMMON_H
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Registers the element counts 1, 10, ..., 10^8 as arguments of a benchmark.
+ *
+ * Counts above the PYAMTRACK_BENCHMARK_MAX_ELEMENTS environment variable are skipped; the largest
+ * inputs need a few GB of memory.
+ */
+void element_counts(benchmark::internal::Benchmark* benchmark);
+
+/**
+ * @brief Like element_counts, but up to 10^7 elements: Python lists take about 32 bytes per element.
+ */
+void list_element_counts(benchmark::internal::Benchmark* benchmark);
+
+/**
+ * @brief Returns n energies in MeV (per nucleon), log-spaced between 1 and 1000 MeV.
+ */
+std::vector<double> benchmark_energies(int64_t n);
+
+/**
+ * @brief Starts the embedded Python interpreter and imports pyamtrack for the wrapper benchmarks.
+ *
+ * pyamtrack must be importable from the interpreter (e.g. installed with pip). When it is not,
+ * the wrapper benchmarks are reported as skipped and the kernel benchmarks still run.
+ *
+ * @return Whether pyamtrack could be imported.
+ */
+bool start_python();
+
+/**
+ * @brief Releases the imported modules and finalizes the embedded interpreter.
+ */
+void stop_python();
+
+#endif  // BENCHMARKS_BENCH_COMMON_H
@@ -0,0 +1,34 @@
+// Cold-start cost of pyamtrack: a new interpreter process importing the package, compared to the same
+// process importing nothing. The difference is the import time paid by short-lived worker processes.
+
+#include <cstdlib>
+#include <string>
+
+#include "bench_common.h"
+
+namespace {
+
+// Interpreter the benchmarks were built against (set by CMake)
+#ifndef PYAMTRACK_PYTHON_EXECUTABLE
+#define PYAMTRACK_PYTHON_EXECUTABLE "python3"
+#endif
+
+// Runs `python -c <code>` once per iteration; a failing command skips the benchmark
+void BM_import(benchmark::State& state, const char* code) {
+  const std::string command = std::string("\"") + PYAMTRACK_PYTHON_EXECUTABLE + "\" -c \"" + code + "\"";
+  for (auto _ : state) {
+    if (std::system(command.c_str()) != 0) {
+      state.SkipWithError(("Running " + command + " failed").c_str());
+      return;
+    }
+  }
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(BM_import, python_only, "pass")->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_import, pyamtrack, "import pyamtrack")->UseRealTime()->Unit(benchmark::kMillisecond);
+// Accessing a material attribute creates it on first use, see the module __getattr__ of pyamtrack.materials
+BENCHMARK_CAPTURE(BM_import, pyamtrack_material, "import pyamtrack; pyamtrack.materials.water_liquid")
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,101 @@
+// Cost of the physics kernels on their own, without the wrapper layer, on a single thread
+
+#include <memory>
+#include <vector>
+
+#include "../src/converters/simd_kernels.h"
+#include "../src/stopping/range_table.h"
+#include "bench_common.h"
+
+extern "C" {
+#include "AT_ElectronRange.h"
+#include "AT_PhysicsRoutines.h"
+}
+
+namespace {
+
+// Items/s of a benchmark evaluating state.range(0) elements per iteration
+void set_processed(benchmark::State& state) { state.SetItemsProcessed(state.iterations() * state.range(0)); }
+
+void BM_AT_beta_from_E_single(benchmark::State& state) {
+  std::vector<double> energies = benchmark_energies(state.range(0));
+  std::vector<double> results(energies.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < energies.size(); ++i) results[i] = AT_beta_from_E_single(energies[i]);
+    benchmark::DoNotOptimize(results.data());
+    benchmark::ClobberMemory();
+  }
+  set_processed(state);
+}
+
+void BM_AT_E_from_beta_single(benchmark::State& state) {
+  std::vector<double> betas = benchmark_energies(state.range(0));
+  for (double& beta : betas) beta = AT_beta_from_E_single(beta);
+  std::vector<double> results(betas.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < betas.size(); ++i) results[i] = AT_E_from_beta_single(betas[i]);
+    benchmark::DoNotOptimize(results.data());
+    benchmark::ClobberMemory();
+  }
+  set_processed(state);
+}
+
+void BM_simd_beta_from_energy(benchmark::State& state) {
+  BatchFunc kernel = beta_from_energy_kernel();
+  if (!kernel) {
+    state.SkipWithError("The SIMD kernel is disabled");
+    return;
+  }
+  std::vector<double> energies = benchmark_energies(state.range(0));
+  std::vector<double> results(energies.size());
+  for (auto _ : state) {
+    kernel(energies.data(), results.data(), energies.size());
+    benchmark::DoNotOptimize(results.data());
+    benchmark::ClobberMemory();
+  }
+  set_processed(state);
+}
+
+void BM_AT_max_electron_range_m(benchmark::State& state) {
+  std::vector<double> energies = benchmark_energies(state.range(0));
+  std::vector<double> results(energies.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < energies.size(); ++i) results[i] = AT_max_electron_range_m(energies[i], 1, 7);
+    benchmark::DoNotOptimize(results.data());
+    benchmark::ClobberMemory();
+  }
+  set_processed(state);
+}
+
+void BM_AT_max_electron_ranges_m(benchmark::State& state) {
+  std::vector<double> energies = benchmark_energies(state.range(0));
+  std::vector<double> results(energies.size());
+  for (auto _ : state) {
+    AT_max_electron_ranges_m(static_cast<long>(energies.size()), energies.data(), 1, 7, results.data());
+    benchmark::DoNotOptimize(results.data());
+    benchmark::ClobberMemory();
+  }
+  set_processed(state);
+}
+
+void BM_range_table_lookup(benchmark::State& state) {
+  std::shared_ptr<const RangeTable> table = get_range_table(1, 7);
+  std::vector<double> energies = benchmark_energies(state.range(0));
+  std::vector<double> results(energies.size());
+  for (auto _ : state) {
+    size_t hint = 0;
+    for (size_t i = 0; i < energies.size(); ++i) results[i] = table->lookup(energies[i], hint);
+    benchmark::DoNotOptimize(results.data());
+    benchmark::ClobberMemory();
+  }
+  set_processed(state);
+}
+
+}  // namespace
+
+BENCHMARK(BM_AT_beta_from_E_single)->Apply(element_counts);
+BENCHMARK(BM_AT_E_from_beta_single)->Apply(element_counts);
+BENCHMARK(BM_simd_beta_from_energy)->Apply(element_counts);
+BENCHMARK(BM_AT_max_electron_range_m)->Apply(element_counts);
+BENCHMARK(BM_AT_max_electron_ranges_m)->Apply(element_counts);
+BENCHMARK(BM_range_table_lookup)->Apply(element_counts);
@@ -0,0 +1,149 @@
+// Cost of the wrapper layer: pyamtrack functions called through an embedded Python interpreter,
+// from argument parsing to the construction of the result
+
+#include <Python.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench_common.h"
+
+namespace {
+
+struct PyObjectDeleter {
+  void operator()(PyObject* object) const { Py_XDECREF(object); }
+};
+
+// Owned reference to a Python object
+using PyObjectPtr = std::unique_ptr<PyObject, PyObjectDeleter>;
+
+PyObjectPtr numpy;
+PyObjectPtr converters;
+PyObjectPtr stopping;
+
+// Materials and models of the cartesian product benchmarks: 4 x 2 pairs per energy
+constexpr int64_t CARTESIAN_PAIRS = 8;
+
+// Returns a function of pyamtrack.<module>, or nullptr after marking the benchmark as skipped
+PyObjectPtr function(benchmark::State& state, const PyObjectPtr& module, const char* name) {
+  if (!module) {
+    state.SkipWithError("pyamtrack cannot be imported by the embedded interpreter");
+    return nullptr;
+  }
+  PyObjectPtr result(PyObject_GetAttrString(module.get(), name));
+  if (!result) {
+    PyErr_Clear();
+    state.SkipWithError(("pyamtrack has no function " + std::string(name)).c_str());
+  }
+  return result;
+}
+
+// NumPy array of n energies, log-spaced between 1 and 1000 MeV
+PyObjectPtr energy_array(int64_t n) {
+  return PyObjectPtr(PyObject_CallMethod(numpy.get(), "geomspace", "ddL", 1.0, 1000.0, static_cast<long long>(n)));
+}
+
+// Calls function(*args, **kwargs) in the benchmark loop; Python errors skip the benchmark
+void run(benchmark::State& state, PyObject* function, PyObject* args, PyObject* kwargs, int64_t elements) {
+  if (!args) {
+    PyErr_Print();
+    state.SkipWithError("Creating the arguments failed");
+    return;
+  }
+  for (auto _ : state) {
+    PyObjectPtr result(PyObject_Call(function, args, kwargs));
+    if (!result) {
+      PyErr_Print();
+      state.SkipWithError("The call raised an exception");
+      return;
+    }
+    benchmark::DoNotOptimize(result.get());
+  }
+  state.SetItemsProcessed(state.iterations() * elements);
+}
+
+PyObjectPtr& module_of(const char* module) { return std::string(module) == "converters" ? converters : stopping; }
+
+// Latency of a call with a single Python float, the path of scalar inputs
+void BM_wrapper_scalar(benchmark::State& state, const char* module, const char* name) {
+  PyObjectPtr func = function(state, module_of(module), name);
+  if (!func) return;
+  PyObjectPtr args(Py_BuildValue("(d)", 100.0));
+  run(state, func.get(), args.get(), nullptr, 1);
+}
+
+void BM_wrapper_list(benchmark::State& state, const char* module, const char* name) {
+  PyObjectPtr func = function(state, module_of(module), name);
+  if (!func) return;
+  PyObjectPtr energies = energy_array(state.range(0));
+  PyObjectPtr list(energies ? PyObject_CallMethod(energies.get(), "tolist", nullptr) : nullptr);
+  PyObjectPtr args(list ? PyTuple_Pack(1, list.get()) : nullptr);
+  run(state, func.get(), args.get(), nullptr, state.range(0));
+}
+
+void BM_wrapper_ndarray(benchmark::State& state, const char* module, const char* name) {
+  PyObjectPtr func = function(state, module_of(module), name);
+  if (!func) return;
+  PyObjectPtr energies = energy_array(state.range(0));
+  PyObjectPtr args(energies ? PyTuple_Pack(1, energies.get()) : nullptr);
+  run(state, func.get(), args.get(), nullptr, state.range(0));
+}
+
+// electron_range over energies x 4 materials x 2 models, with state.range(0) results in total
+void BM_wrapper_cartesian(benchmark::State& state) {
+  PyObjectPtr func = function(state, stopping, "electron_range");
+  if (!func) return;
+  const int64_t num_energies = std::max<int64_t>(1, state.range(0) / CARTESIAN_PAIRS);
+  PyObjectPtr energies = energy_array(num_energies);
+  PyObjectPtr args(energies ? Py_BuildValue("(O[iiii][ss])", energies.get(), 1, 2, 3, 5, "tabata", "scholz")
+                            : nullptr);
+  PyObjectPtr kwargs(Py_BuildValue("{s:O}", "cartesian_product", Py_True));
+  run(state, func.get(), args.get(), kwargs.get(), num_energies * CARTESIAN_PAIRS);
+}
+
+}  // namespace
+
+bool start_python() {
+  Py_Initialize();
+  numpy.reset(PyImport_ImportModule("numpy"));
+  if (numpy) {
+    converters.reset(PyImport_ImportModule("pyamtrack.converters"));
+    stopping.reset(PyImport_ImportModule("pyamtrack.stopping"));
+  }
+  if (!numpy || !converters || !stopping) {
+    PyErr_Print();
+    numpy.reset();
+    converters.reset();
+    stopping.reset();
+    return false;
+  }
+  return true;
+}
+
+void stop_python() {
+  numpy.reset();
+  converters.reset();
+  stopping.reset();
+  Py_Finalize();
+}
+
+BENCHMARK_CAPTURE(BM_wrapper_scalar, beta_from_energy, "converters", "beta_from_energy");
+BENCHMARK_CAPTURE(BM_wrapper_scalar, electron_range, "stopping", "electron_range");
+
+BENCHMARK_CAPTURE(BM_wrapper_list, beta_from_energy, "converters", "beta_from_energy")
+    ->Apply(list_element_counts)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_wrapper_list, electron_range, "stopping", "electron_range")
+    ->Apply(list_element_counts)
+    ->UseRealTime();
+
+BENCHMARK_CAPTURE(BM_wrapper_ndarray, beta_from_energy, "converters", "beta_from_energy")
+    ->Apply(element_counts)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_wrapper_ndarray, electron_range, "stopping", "electron_range")
+    ->Apply(element_counts)
+    ->UseRealTime();
+
+BENCHMARK(BM_wrapper_cartesian)->Apply(element_counts)->UseRealTime();
@@ -0,0 +1,35 @@
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../src/converters/simd_kernels.h"
+#include "../src/runtime/thread_pool.h"
+#include "bench_common.h"
+
+int main(int argc, char** argv) {
+  // Results are written as JSON unless another format is requested, so runs can be compared with
+  // e.g. benchmark's compare.py; --benchmark_out=<file> writes them to a file instead of stdout
+  std::vector<char*> arguments(argv, argv + argc);
+  bool format_given = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strncmp(argv[i], "--benchmark_format", 18) == 0) format_given = true;
+  }
+  std::string json_format = "--benchmark_format=json";
+  if (!format_given) arguments.push_back(&json_format[0]);
+
+  int count = static_cast<int>(arguments.size());
+  benchmark::Initialize(&count, arguments.data());
+  if (benchmark::ReportUnrecognizedArguments(count, arguments.data())) return 1;
+
+  const bool python = start_python();
+  benchmark::AddCustomContext("pyamtrack_python", python ? "available" : "unavailable");
+  benchmark::AddCustomContext("pyamtrack_num_threads", std::to_string(get_num_threads()));
+  benchmark::AddCustomContext("pyamtrack_simd_level", simd_level_name(simd_level()));
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  stop_python();
+  return 0;
+}
@@ -0,0 +1,52 @@
+#!/bin/bash
+
+# Builds the single-module, link-time and profile-guided optimized pyamtrack wheel (see docs/optimized_build.md).
+# Run it from the repository root, in a virtual environment with the development dependencies installed.
+
+# Exit immediately if a command exits with a non-zero status.
+set -e
+
+# Function to display error message and exit
+function error {
+    echo "Error: $1"
+    exit 1
+}
+
+# Both phases must use the same build directory: GCC looks up the profile of an object file by its path
+BUILD_DIR=./build-pgo/build
+PROFILE_DIR=$(pwd)/build-pgo/profile
+MAX_ELEMENTS=${PYAMTRACK_BENCHMARK_MAX_ELEMENTS:-1000000}
+
+function build_wheel {
+    rm -rf dist || error "Failed to clean the dist directory."
+    python -m build --wheel --no-isolation --config-setting=build-dir=$BUILD_DIR \
+        -Ccmake.define.PYAMTRACK_SINGLE_MODULE=ON \
+        -Ccmake.define.PYAMTRACK_BUILD_BENCHMARKS=ON \
+        -Ccmake.define.PYAMTRACK_PGO=$1 \
+        -Ccmake.define.PYAMTRACK_PGO_DIR=$PROFILE_DIR || error "Failed to build the wheel package ($1)."
+    pip install --force-reinstall --no-deps dist/*.whl || error "Failed to install the wheel package ($1)."
+}
+
+# 1. Instrumented build
+echo "Building the instrumented wheel..."
+rm -rf "$PROFILE_DIR"
+mkdir -p "$PROFILE_DIR"
+build_wheel generate
+
+# 2. Training on the wrapper benchmark workloads
+echo "Running the training workload..."
+PYAMTRACK_BENCHMARK_MAX_ELEMENTS=$MAX_ELEMENTS $BUILD_DIR/pyamtrack_benchmarks \
+    --benchmark_filter=BM_wrapper --benchmark_format=console || error "Failed to run the training workload."
+
+# Clang writes raw profiles, which are merged into the single file read by the optimized build
+if ls "$PROFILE_DIR"/*.profraw > /dev/null 2>&1; then
+    echo "Merging the profiles..."
+    llvm-profdata merge -output="$PROFILE_DIR/pyamtrack.profdata" "$PROFILE_DIR"/*.profraw || error "Failed to merge the profiles."
+fi
+
+# 3. Optimized build
+echo "Building the optimized wheel..."
+build_wheel use
+
+python -c "import pyamtrack; print(pyamtrack.converters.beta_from_energy(150))" || error "Failed to import pyamtrack."
+echo "Optimized wheel built and installed: $(ls dist/*.whl)"
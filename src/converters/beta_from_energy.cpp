@@ -1,11 +1,14 @@
 #include "beta_from_energy.h"
 
+#include "../runtime/stats.h"
 #include "../wrapper/single_argument.h"
+#include "simd_kernels.h"
 
 extern "C" {
 #include "AT_PhysicsRoutines.h"
 }
 
-nb::object beta_from_energy(nb::object energy_MeV_u) {
-  return wrap_function(AT_beta_from_E_single, energy_MeV_u);
+nb::object beta_from_energy(nb::object energy_MeV_u, nb::object out, nb::object where, nb::object dtype) {
+  StatsCall call("converters.beta_from_energy");
+  return wrap_function(AT_beta_from_E_single, energy_MeV_u, out, where, dtype, beta_from_energy_kernel());
 }
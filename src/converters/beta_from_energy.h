@@ -5,6 +5,6 @@
 
 namespace nb = nanobind;
 
-nb::object beta_from_energy(nb::object energy_MeV_u);
+nb::object beta_from_energy(nb::object energy_MeV_u, nb::object out, nb::object where, nb::object dtype);
 
 #endif  // BETA_FROM_ENERGY_H
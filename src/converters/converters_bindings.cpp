@@ -1,7 +1,11 @@
 #include <nanobind/nanobind.h>
+#include <nanobind/stl/string.h>
+#include <nanobind/stl/vector.h>
 
 #include "beta_from_energy.h"
 #include "energy_from_beta.h"
+#include "../wrapper/module.h"
+#include "simd_kernels.h"
 
 namespace nb = nanobind;
 
@@ -10,9 +14,16 @@ const char* beta_from_energy_doc = R"pbdoc(
 
     Parameters:
         energy_MeV_u (float | int | numpy.ndarray | list): The particle kinetic energy in MeV/u. Can be a single value, a NumPy array, or a Python list.
+        out (numpy.ndarray, optional): A writable, C-contiguous float64 (or float32) array of the result shape to store the results in.
+        where (bool | numpy.ndarray, optional): Boolean mask broadcastable to the result shape. Values are computed only
+            where it is True; elsewhere `out` keeps its values, or the result holds NaN when `out` is not given.
+        dtype (numpy.dtype, optional): Dtype of the result array, numpy.float64 (default) or numpy.float32.
+            float32 halves the memory of large results; values are still computed in double precision.
 
     Returns:
-        float | numpy.ndarray | list: The calculated beta value(s). Returns a float for a single input, a NumPy array for a NumPy array input, or a Python list for a list input.
+        float | numpy.ndarray | list: The calculated beta value(s). Returns a float for a single input, a NumPy array
+            for a NumPy array input and a Python list for a list input. With `out`, `where` or `dtype`, a list input
+            gives a NumPy array as well. When `out` is given, it is returned.
 )pbdoc";
 
 const char* energy_from_beta_doc = R"pbdoc(
@@ -20,15 +31,50 @@ const char* energy_from_beta_doc = R"pbdoc(
 
     Parameters:
         beta (float | int | numpy.ndarray | list): The beta value(s). Can be a single value, a NumPy array, or a Python list.
+        out (numpy.ndarray, optional): A writable, C-contiguous float64 (or float32) array of the result shape to store the results in.
+        where (bool | numpy.ndarray, optional): Boolean mask broadcastable to the result shape. Values are computed only
+            where it is True; elsewhere `out` keeps its values, or the result holds NaN when `out` is not given.
+        dtype (numpy.dtype, optional): Dtype of the result array, numpy.float64 (default) or numpy.float32.
+            float32 halves the memory of large results; values are still computed in double precision.
 
     Returns:
-        float | numpy.ndarray | list: The calculated energy value(s). Returns a float for a single input, a NumPy array for a NumPy array input, or a Python list for a list input.
+        float | numpy.ndarray | list: The calculated energy value(s). Returns a float for a single input, a NumPy array
+            for a NumPy array input and a Python list for a list input. With `out`, `where` or `dtype`, a list input
+            gives a NumPy array as well. When `out` is given, it is returned.
     )pbdoc";
 
-NB_MODULE(converters, m) {
+PYAMTRACK_MODULE(converters, m) {
   m.doc() = "Functions for converting between different physical quantities.";
 
-  m.def("beta_from_energy", &beta_from_energy, nb::arg("energy_MeV_u"), beta_from_energy_doc);
+  m.def("beta_from_energy", &beta_from_energy, nb::arg("energy_MeV_u"), nb::kw_only(), nb::arg("out") = nb::none(),
+        nb::arg("where") = nb::none(), nb::arg("dtype") = nb::none(), beta_from_energy_doc);
 
-  m.def("energy_from_beta", &energy_from_beta, nb::arg("beta"), energy_from_beta_doc);
+  m.def("energy_from_beta", &energy_from_beta, nb::arg("beta"), nb::kw_only(), nb::arg("out") = nb::none(),
+        nb::arg("where") = nb::none(), nb::arg("dtype") = nb::none(), energy_from_beta_doc);
+
+  m.def(
+      "simd_info",
+      []() {
+        nb::dict info;
+        info["level"] = simd_level_name(simd_level());
+        info["beta_from_energy"] = beta_from_energy_kernel() != nullptr;
+        info["energy_from_beta"] = energy_from_beta_kernel() != nullptr;
+        info["rejected"] = rejected_simd_kernels();
+        info["max_ulp"] = SIMD_MAX_ULP;
+        return info;
+      },
+      R"pbdoc(
+        Returns the SIMD kernels used by beta_from_energy and energy_from_beta on arrays.
+
+        The instruction set ("avx512", "avx2", "sse2" or "scalar") is detected at runtime from the CPU
+        and can be lowered with the PYAMTRACK_SIMD environment variable. Each kernel is validated against
+        the libamtrack routine on first use and is only used if the results agree within `max_ulp`
+        units in the last place; otherwise, and for scalar inputs, libamtrack is called element by element.
+        A kernel which fails validation is listed in `rejected`, which points at a change of the formulas or
+        constants of libamtrack.
+
+        Returns:
+            dict: `level`, whether the `beta_from_energy` and `energy_from_beta` kernels are used, the names
+            of the `rejected` kernels, and `max_ulp`.
+    )pbdoc");
 }
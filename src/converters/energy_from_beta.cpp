@@ -1,11 +1,14 @@
 #include "energy_from_beta.h"
 
+#include "../runtime/stats.h"
 #include "../wrapper/single_argument.h"
+#include "simd_kernels.h"
 
 extern "C" {
 #include "AT_PhysicsRoutines.h"
 }
 
-nb::object energy_from_beta(nb::object beta) {
-  return wrap_function(AT_E_from_beta_single, beta);
+nb::object energy_from_beta(nb::object beta, nb::object out, nb::object where, nb::object dtype) {
+  StatsCall call("converters.energy_from_beta");
+  return wrap_function(AT_E_from_beta_single, beta, out, where, dtype, energy_from_beta_kernel());
 }
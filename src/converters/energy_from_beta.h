@@ -5,6 +5,6 @@
 
 namespace nb = nanobind;
 
-nb::object energy_from_beta(nb::object beta);
+nb::object energy_from_beta(nb::object beta, nb::object out, nb::object where, nb::object dtype);
 
 #endif  // ENERGY_FROM_BETA_H
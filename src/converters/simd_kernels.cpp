@@ -0,0 +1,289 @@
+#include "simd_kernels.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "AT_Constants.h"
+#include "AT_PhysicsRoutines.h"
+}
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PYAMTRACK_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC accepts intrinsics of any instruction set without compiler flags
+#define PYAMTRACK_TARGET(isa)
+#else
+#include <cpuid.h>
+// GCC and Clang compile single functions for an instruction set, so the module does not need -mavx2 / -mavx512f
+#define PYAMTRACK_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace {
+
+// Atomic mass unit in MeV/c^2, the constant of libamtrack's gamma and energy conversions
+constexpr double ATOMIC_UNIT_MeV = atomic_unit_MeV;
+
+// The scalar expressions of libamtrack, evaluated in the same order of operations as the kernels below.
+// They also handle the elements left over after the last full vector.
+inline double beta_formula(double energy_MeV_u) {
+  double gamma = 1.0 + energy_MeV_u / ATOMIC_UNIT_MeV;
+  return std::sqrt(1.0 - 1.0 / (gamma * gamma));
+}
+
+inline double energy_formula(double beta) {
+  double gamma = 1.0 / std::sqrt(1.0 - beta * beta);
+  return ATOMIC_UNIT_MeV * (gamma - 1.0);
+}
+
+#ifdef PYAMTRACK_SIMD_X86
+
+PYAMTRACK_TARGET("sse2")
+void beta_from_energy_sse2(const double* energy, double* beta, size_t n) {
+  const __m128d one = _mm_set1_pd(1.0);
+  const __m128d mass = _mm_set1_pd(ATOMIC_UNIT_MeV);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d gamma = _mm_add_pd(one, _mm_div_pd(_mm_loadu_pd(energy + i), mass));
+    _mm_storeu_pd(beta + i, _mm_sqrt_pd(_mm_sub_pd(one, _mm_div_pd(one, _mm_mul_pd(gamma, gamma)))));
+  }
+  for (; i < n; ++i) beta[i] = beta_formula(energy[i]);
+}
+
+PYAMTRACK_TARGET("sse2")
+void energy_from_beta_sse2(const double* beta, double* energy, size_t n) {
+  const __m128d one = _mm_set1_pd(1.0);
+  const __m128d mass = _mm_set1_pd(ATOMIC_UNIT_MeV);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d b = _mm_loadu_pd(beta + i);
+    __m128d gamma = _mm_div_pd(one, _mm_sqrt_pd(_mm_sub_pd(one, _mm_mul_pd(b, b))));
+    _mm_storeu_pd(energy + i, _mm_mul_pd(mass, _mm_sub_pd(gamma, one)));
+  }
+  for (; i < n; ++i) energy[i] = energy_formula(beta[i]);
+}
+
+PYAMTRACK_TARGET("avx2")
+void beta_from_energy_avx2(const double* energy, double* beta, size_t n) {
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d mass = _mm256_set1_pd(ATOMIC_UNIT_MeV);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d gamma = _mm256_add_pd(one, _mm256_div_pd(_mm256_loadu_pd(energy + i), mass));
+    _mm256_storeu_pd(beta + i, _mm256_sqrt_pd(_mm256_sub_pd(one, _mm256_div_pd(one, _mm256_mul_pd(gamma, gamma)))));
+  }
+  for (; i < n; ++i) beta[i] = beta_formula(energy[i]);
+}
+
+PYAMTRACK_TARGET("avx2")
+void energy_from_beta_avx2(const double* beta, double* energy, size_t n) {
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d mass = _mm256_set1_pd(ATOMIC_UNIT_MeV);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d b = _mm256_loadu_pd(beta + i);
+    __m256d gamma = _mm256_div_pd(one, _mm256_sqrt_pd(_mm256_sub_pd(one, _mm256_mul_pd(b, b))));
+    _mm256_storeu_pd(energy + i, _mm256_mul_pd(mass, _mm256_sub_pd(gamma, one)));
+  }
+  for (; i < n; ++i) energy[i] = energy_formula(beta[i]);
+}
+
+PYAMTRACK_TARGET("avx512f")
+void beta_from_energy_avx512(const double* energy, double* beta, size_t n) {
+  const __m512d one = _mm512_set1_pd(1.0);
+  const __m512d mass = _mm512_set1_pd(ATOMIC_UNIT_MeV);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512d gamma = _mm512_add_pd(one, _mm512_div_pd(_mm512_loadu_pd(energy + i), mass));
+    _mm512_storeu_pd(beta + i, _mm512_sqrt_pd(_mm512_sub_pd(one, _mm512_div_pd(one, _mm512_mul_pd(gamma, gamma)))));
+  }
+  for (; i < n; ++i) beta[i] = beta_formula(energy[i]);
+}
+
+PYAMTRACK_TARGET("avx512f")
+void energy_from_beta_avx512(const double* beta, double* energy, size_t n) {
+  const __m512d one = _mm512_set1_pd(1.0);
+  const __m512d mass = _mm512_set1_pd(ATOMIC_UNIT_MeV);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512d b = _mm512_loadu_pd(beta + i);
+    __m512d gamma = _mm512_div_pd(one, _mm512_sqrt_pd(_mm512_sub_pd(one, _mm512_mul_pd(b, b))));
+    _mm512_storeu_pd(energy + i, _mm512_mul_pd(mass, _mm512_sub_pd(gamma, one)));
+  }
+  for (; i < n; ++i) energy[i] = energy_formula(beta[i]);
+}
+
+void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t registers[4]) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  int values[4];
+  __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+  for (int k = 0; k < 4; ++k) registers[k] = static_cast<uint32_t>(values[k]);
+#else
+  if (!__get_cpuid_count(leaf, subleaf, &registers[0], &registers[1], &registers[2], &registers[3])) {
+    registers[0] = registers[1] = registers[2] = registers[3] = 0;
+  }
+#endif
+}
+
+// Register state enabled by the operating system (XCR0)
+uint64_t enabled_xsave_features() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return _xgetbv(0);
+#else
+  uint32_t eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+SimdLevel cpu_simd_level() {
+  uint32_t leaf1[4], leaf7[4];
+  cpuid(0, 0, leaf1);
+  const uint32_t max_leaf = leaf1[0];
+  cpuid(1, 0, leaf1);
+  if (max_leaf >= 7) {
+    cpuid(7, 0, leaf7);
+  } else {
+    leaf7[0] = leaf7[1] = leaf7[2] = leaf7[3] = 0;
+  }
+
+  const bool sse2 = leaf1[3] & (1u << 26);
+  if (!sse2) return SimdLevel::Scalar;
+
+  // AVX registers are only usable if the operating system saves them on context switches
+  const bool osxsave = leaf1[2] & (1u << 27);
+  const uint64_t xcr0 = osxsave ? enabled_xsave_features() : 0;
+  const bool avx_state = (xcr0 & 0x6) == 0x6;       // SSE and AVX state
+  const bool avx512_state = (xcr0 & 0xe6) == 0xe6;  // and opmask, ZMM0-15 upper halves, ZMM16-31
+
+  const bool avx2 = avx_state && (leaf1[2] & (1u << 28)) && (leaf7[1] & (1u << 5));
+  const bool avx512f = avx2 && avx512_state && (leaf7[1] & (1u << 16));
+  if (avx512f) return SimdLevel::AVX512;
+  if (avx2) return SimdLevel::AVX2;
+  return SimdLevel::SSE2;
+}
+
+#else
+
+SimdLevel cpu_simd_level() { return SimdLevel::Scalar; }
+
+#endif  // PYAMTRACK_SIMD_X86
+
+SimdLevel select_simd_level() {
+  SimdLevel level = cpu_simd_level();
+  if (const char* env = std::getenv("PYAMTRACK_SIMD")) {
+    // The variable can only lower the level, the CPU may not support a higher one
+    for (SimdLevel requested : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512}) {
+      if (std::strcmp(env, simd_level_name(requested)) == 0 && requested < level) level = requested;
+    }
+  }
+  return level;
+}
+
+// Checks a kernel against the libamtrack routine over the given inputs, which include special values
+bool validate(BatchFunc kernel, double (*reference)(double), const std::vector<double>& inputs) {
+  std::vector<double> results(inputs.size());
+  kernel(inputs.data(), results.data(), inputs.size());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    if (ulp_distance(results[i], reference(inputs[i])) > SIMD_MAX_ULP) return false;
+  }
+  return true;
+}
+
+struct Kernels {
+  SimdLevel level = SimdLevel::Scalar;
+  BatchFunc beta_from_energy = nullptr;
+  BatchFunc energy_from_beta = nullptr;
+  std::vector<std::string> rejected;
+};
+
+Kernels select_kernels() {
+  Kernels kernels;
+  kernels.level = select_simd_level();
+#ifdef PYAMTRACK_SIMD_X86
+  switch (kernels.level) {
+    case SimdLevel::AVX512:
+      kernels.beta_from_energy = beta_from_energy_avx512;
+      kernels.energy_from_beta = energy_from_beta_avx512;
+      break;
+    case SimdLevel::AVX2:
+      kernels.beta_from_energy = beta_from_energy_avx2;
+      kernels.energy_from_beta = energy_from_beta_avx2;
+      break;
+    case SimdLevel::SSE2:
+      kernels.beta_from_energy = beta_from_energy_sse2;
+      kernels.energy_from_beta = energy_from_beta_sse2;
+      break;
+    case SimdLevel::Scalar:
+      break;
+  }
+#endif
+  if (kernels.level == SimdLevel::Scalar) return kernels;
+
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double inf = std::numeric_limits<double>::infinity();
+  std::vector<double> energies = {0.0, -0.0, -1.0, -1e4, 1e-300, inf, nan};
+  for (double energy = 1e-8; energy <= 1e8; energy *= 1.01) energies.push_back(energy);
+  std::vector<double> betas = {0.0, -0.0, 1.0, -1.0, 1.5, 1e-300, inf, nan};
+  for (double beta = 1e-8; beta < 1.0; beta *= 1.01) betas.push_back(beta);
+  for (double beta = 0.0; beta < 1.0; beta += 1e-3) betas.push_back(-beta);
+  for (double gap = 1e-3; gap > 1e-15; gap *= 0.9) betas.push_back(1.0 - gap);
+
+  if (!validate(kernels.beta_from_energy, AT_beta_from_E_single, energies)) {
+    kernels.beta_from_energy = nullptr;
+    kernels.rejected.push_back("beta_from_energy");
+  }
+  if (!validate(kernels.energy_from_beta, AT_E_from_beta_single, betas)) {
+    kernels.energy_from_beta = nullptr;
+    kernels.rejected.push_back("energy_from_beta");
+  }
+  return kernels;
+}
+
+// Selected and validated once, on first use
+const Kernels& kernels() {
+  static const Kernels selected = select_kernels();
+  return selected;
+}
+
+}  // namespace
+
+SimdLevel simd_level() { return kernels().level; }
+
+const char* simd_level_name(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::SSE2:
+      return "sse2";
+    case SimdLevel::AVX2:
+      return "avx2";
+    case SimdLevel::AVX512:
+      return "avx512";
+    case SimdLevel::Scalar:
+      break;
+  }
+  return "scalar";
+}
+
+int64_t ulp_distance(double a, double b) {
+  if (std::isnan(a) || std::isnan(b)) return std::isnan(a) && std::isnan(b) ? 0 : std::numeric_limits<int64_t>::max();
+  if (a == b) return 0;
+  if (std::signbit(a) != std::signbit(b)) return std::numeric_limits<int64_t>::max();
+  // For doubles of the same sign, the order of the bit patterns is the order of the magnitudes
+  int64_t bits_a, bits_b;
+  std::memcpy(&bits_a, &a, sizeof(double));
+  std::memcpy(&bits_b, &b, sizeof(double));
+  return bits_a > bits_b ? bits_a - bits_b : bits_b - bits_a;
+}
+
+BatchFunc beta_from_energy_kernel() { return kernels().beta_from_energy; }
+
+BatchFunc energy_from_beta_kernel() { return kernels().energy_from_beta; }
+
+const std::vector<std::string>& rejected_simd_kernels() { return kernels().rejected; }
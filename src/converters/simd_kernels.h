@@ -0,0 +1,69 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../wrapper/types.h"
+
+/**
+ * @brief Instruction sets the converter kernels are compiled for, in increasing order.
+ */
+enum class SimdLevel { Scalar, SSE2, AVX2, AVX512 };
+
+/**
+ * @brief Largest distance, in units in the last place, allowed between a kernel and the libamtrack routine.
+ *
+ * The kernels evaluate the same closed-form expressions as AT_beta_from_E_single and AT_E_from_beta_single,
+ * operation by operation and with the atomic mass unit of libamtrack (atomic_unit_MeV), so they are expected
+ * to agree exactly. A kernel which differs by more than this
+ * on the validation inputs (e.g. after a change of the formula in libamtrack) is not used, and is reported by
+ * rejected_simd_kernels().
+ */
+constexpr int64_t SIMD_MAX_ULP = 2;
+
+/**
+ * @brief Returns the instruction set used by the converter kernels.
+ *
+ * This is the widest instruction set supported by the CPU (queried with CPUID) and the operating
+ * system, capped by the PYAMTRACK_SIMD environment variable ("scalar", "sse2", "avx2" or "avx512").
+ * On other architectures than x86 it is always SimdLevel::Scalar.
+ */
+SimdLevel simd_level();
+
+/**
+ * @brief Returns the name of an instruction set, as accepted by PYAMTRACK_SIMD.
+ */
+const char* simd_level_name(SimdLevel level);
+
+/**
+ * @brief Returns the distance between two doubles in units in the last place.
+ *
+ * Equal values (including +0 and -0, and infinities of the same sign) and two NaNs are 0 apart; a NaN and
+ * a number, or values of different signs, are INT64_MAX apart.
+ */
+int64_t ulp_distance(double a, double b);
+
+/**
+ * @brief Returns the kernel evaluating AT_beta_from_E_single on arrays, or nullptr.
+ *
+ * nullptr is returned when simd_level() is SimdLevel::Scalar, or when the kernel did not reproduce
+ * AT_beta_from_E_single within SIMD_MAX_ULP on the validation inputs.
+ */
+BatchFunc beta_from_energy_kernel();
+
+/**
+ * @brief Returns the kernel evaluating AT_E_from_beta_single on arrays, or nullptr (see beta_from_energy_kernel).
+ */
+BatchFunc energy_from_beta_kernel();
+
+/**
+ * @brief Returns the names of the kernels ("beta_from_energy", "energy_from_beta") which failed validation.
+ *
+ * Rejected kernels are replaced by element-wise calls of libamtrack. The list is empty when simd_level() is
+ * SimdLevel::Scalar, as no kernel is validated then.
+ */
+const std::vector<std::string>& rejected_simd_kernels();
+
+#endif  // SIMD_KERNELS_H
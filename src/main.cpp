@@ -1,10 +1,40 @@
 #include <nanobind/nanobind.h>
 
+#include <string>
+
+#include "runtime/stats.h"
+#include "runtime/thread_pool.h"
+
 #define STRINGIFY(x) #x
 #define MACRO_STRINGIFY(x) STRINGIFY(x)
 
 namespace nb = nanobind;
 
+#ifdef PYAMTRACK_SINGLE_MODULE
+// Submodule bindings, defined with PYAMTRACK_MODULE (see wrapper/module.h)
+void init_converters(nb::module_& m);
+void init_materials(nb::module_& m);
+void init_particles(nb::module_& m);
+void init_stopping(nb::module_& m);
+
+/**
+ * Creates the submodule `name` of _core and registers it as `<package>.<name>`, the name it has when it is
+ * an extension module of its own, so that imports, pickling and the __module__ of its classes are unchanged.
+ */
+void add_submodule(nb::module_& m, const char* name, void (*init)(nb::module_&)) {
+  std::string package = nb::cast<std::string>(m.attr("__name__"));
+  size_t dot = package.rfind('.');
+  package = dot == std::string::npos ? "pyamtrack" : package.substr(0, dot);
+  const std::string full_name = package + "." + name;
+
+  nb::module_ submodule = m.def_submodule(name);
+  submodule.attr("__name__") = full_name;
+  nb::dict modules = nb::borrow<nb::dict>(nb::module_::import_("sys").attr("modules"));
+  modules[full_name.c_str()] = submodule;
+  init(submodule);
+}
+#endif
+
 NB_MODULE(_core, m) {
   m.doc() = "Python bindings for libamtrack";
 
@@ -13,4 +43,75 @@ NB_MODULE(_core, m) {
 #else
   m.attr("__version__") = "dev";
 #endif
+
+  m.def("set_num_threads", &set_num_threads, nb::arg("num_threads"), nb::arg("pin_threads") = false, R"pbdoc(
+        Sets the number of threads used to evaluate vectorized functions.
+
+        The thread pool is shared by all pyamtrack functions. Large inputs are split into chunks
+        evaluated in parallel, with the GIL released. The initial value can be set with the
+        PYAMTRACK_NUM_THREADS environment variable (and PYAMTRACK_PIN_THREADS=1 for pinning).
+        It also bounds the number of background threads running asynchronous calls, such as
+        stopping.electron_range_async.
+
+        Args:
+            num_threads (int): Number of threads, 0 selects the number of hardware threads.
+            pin_threads (bool): Whether to pin worker threads to CPU cores (Linux only).
+    )pbdoc");
+
+  m.def("get_num_threads", &get_num_threads, R"pbdoc(
+        Returns the number of threads used to evaluate vectorized functions.
+
+        Returns:
+            int: The number of threads.
+    )pbdoc");
+
+  m.def("enable_stats", &set_stats_enabled, nb::arg("enabled") = true, R"pbdoc(
+        Turns the collection of call statistics on or off.
+
+        Statistics are off by default; they can also be turned on with the PYAMTRACK_STATS=1
+        environment variable. While they are off, the instrumentation costs a single atomic load per call.
+
+        Args:
+            enabled (bool): Whether to collect statistics.
+    )pbdoc");
+
+  m.def("stats_enabled", &stats_enabled, "Returns whether call statistics are collected");
+
+  m.def(
+      "stats",
+      []() {
+        nb::dict result;
+        for (const auto& [name, entry] : collected_stats()) {
+          nb::dict function;
+          function["calls"] = entry.calls;
+          function["elements"] = entry.elements;
+          function["parse_seconds"] = entry.parse_seconds;
+          function["compute_seconds"] = entry.compute_seconds;
+          function["result_seconds"] = entry.result_seconds;
+          function["allocated_bytes"] = entry.allocated_bytes;
+          result[name.c_str()] = function;
+        }
+        return result;
+      },
+      R"pbdoc(
+        Returns the call statistics collected since the last reset_stats(), by function.
+
+        Every call of a vectorized function (e.g. "stopping.electron_range") is split into parsing
+        (argument conversion, broadcasting and output allocation), computation (usually without the GIL,
+        on the thread pool) and the construction of the result.
+
+        Returns:
+            dict: For each function name, a dict with `calls`, `elements` (results computed),
+            `parse_seconds`, `compute_seconds`, `result_seconds` and `allocated_bytes`.
+    )pbdoc");
+
+  m.def("reset_stats", &reset_stats, "Clears the collected call statistics");
+
+#ifdef PYAMTRACK_SINGLE_MODULE
+  // stopping resolves pyamtrack.materials.Material when it is initialized
+  add_submodule(m, "converters", &init_converters);
+  add_submodule(m, "materials", &init_materials);
+  add_submodule(m, "particles", &init_particles);
+  add_submodule(m, "stopping", &init_stopping);
+#endif
 }
@@ -1,7 +1,13 @@
 #include "materials.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <unordered_map>
+
+#include "../runtime/thread_pool.h"
+#include "../wrapper/output.h"
+#include "../wrapper/vectorized.h"
 
 Material::Material(long id) : id(id) {
   auto material_index = AT_material_index_from_material_number(id);
@@ -16,14 +22,16 @@ Material::Material(long id) : id(id) {
 }
 
 Material::Material(const std::string& name) {
-  auto id = AT_material_number_from_name(name.c_str());
+  auto id = material_id_from_name(name);
   if (id < 1) {
     throw std::invalid_argument("Material not found: " + name);
   }
   AT_get_material_data(id, &density_g_cm3, &I_eV, &alpha_g_cm2_MeV, &p_MeV, &m_g_cm2, &average_A, &average_Z);
   this->id = id;
   phase = AT_phase_from_material_no(id);
-  this->name = name;
+  char material_name[MATERIAL_NAME_LENGTH];
+  AT_material_name_from_number(id, material_name);
+  this->name = std::string(material_name);
 }
 
 std::vector<long> get_ids() {
@@ -55,3 +63,117 @@ std::vector<std::string> get_names() {
   }
   return names;
 }
+
+long material_id_from_name(const std::string& name) {
+  static const std::unordered_map<std::string, long> ids = [] {
+    const AT_table_of_material_data_struct& data = AT_Material_Data;
+    std::unordered_map<std::string, long> result;
+    for (long row = 1; row < data.n; ++row) {
+      result.emplace(data.material_name[row], data.material_no[row]);
+      result.emplace(to_name(data.material_name[row]), data.material_no[row]);
+    }
+    return result;
+  }();
+  auto it = ids.find(name);
+  return it == ids.end() ? -1 : it->second;
+}
+
+namespace {
+
+// Row of AT_Material_Data for every material id, -1 for ids not in the table
+const std::vector<long>& material_rows() {
+  static const std::vector<long> rows = [] {
+    const AT_table_of_material_data_struct& data = AT_Material_Data;
+    long max_id = 0;
+    for (long row = 1; row < data.n; ++row) max_id = std::max(max_id, data.material_no[row]);
+    std::vector<long> result(max_id + 1, -1);
+    for (long row = 1; row < data.n; ++row) {
+      if (data.material_no[row] >= 0) result[data.material_no[row]] = row;
+    }
+    return result;
+  }();
+  return rows;
+}
+
+long material_row(int64_t id) {
+  const std::vector<long>& rows = material_rows();
+  return id >= 0 && id < static_cast<int64_t>(rows.size()) ? rows[id] : -1;
+}
+
+// Read-only view of the rows 1..n-1 of a column of static data
+template <typename T>
+nb::object column_view(const T* column) {
+  const size_t shape[1] = {static_cast<size_t>(AT_Material_Data.n - 1)};
+  return nb::ndarray<nb::numpy, const T, nb::ndim<1>>(column + 1, 1, shape, nb::handle())
+      .cast(nb::rv_policy::reference);
+}
+
+}  // namespace
+
+nb::dict table() {
+  const AT_table_of_material_data_struct& data = AT_Material_Data;
+  static const std::vector<long> phases = [] {
+    std::vector<long> result(AT_Material_Data.n, 0);
+    for (long row = 1; row < AT_Material_Data.n; ++row) {
+      result[row] = AT_phase_from_material_no(AT_Material_Data.material_no[row]);
+    }
+    return result;
+  }();
+
+  nb::dict columns;
+  columns["id"] = column_view(data.material_no);
+  columns["density_g_cm3"] = column_view(data.density_g_cm3);
+  columns["I_eV"] = column_view(data.I_eV);
+  columns["alpha_g_cm2_MeV"] = column_view(data.alpha_g_cm2_MeV);
+  columns["p_MeV"] = column_view(data.p_MeV);
+  columns["m_g_cm2"] = column_view(data.m_g_cm2);
+  columns["average_A"] = column_view(data.average_A);
+  columns["average_Z"] = column_view(data.average_Z);
+  columns["phase"] = column_view(phases.data());
+  columns["name"] = nb::module_::import_("numpy").attr("array")(get_long_names());
+  return columns;
+}
+
+nb::object material_property(const nb::object& material, const double* column) {
+  // Single material: a Python float, as the attribute of a Material would give
+  if (!nb::isinstance<nb::list>(material) && !nb::isinstance<nb::ndarray<>>(material)) {
+    int id = process_material(material);
+    long row = material_row(id);
+    if (row < 0) throw nb::value_error(("Material not found: " + std::to_string(id)).c_str());
+    return nb::cast(column[row]);
+  }
+
+  nb::object ids = material;
+  if (nb::isinstance<nb::list>(material)) {
+    nb::list list;
+    for (nb::handle element : nb::borrow<nb::list>(material)) list.append(process_material(nb::borrow(element)));
+    ids = list;
+  } else if (!check_int_dtype(material)) {
+    throw nb::type_error("numpy arrays of type other than int unsupported");
+  }
+
+  Column id_column = make_column(ids);
+  const std::vector<int64_t> id_values = gather_column<int64_t>(id_column);
+  OutputBuffer<double> output(nb::none(), id_column.shape);
+  std::atomic<bool> missing{false};
+  {
+    nb::gil_scoped_release release;
+    double* results = output.data();
+    parallel_for(id_values.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        long row = material_row(id_values[i]);
+        if (row < 0) {
+          missing.store(true, std::memory_order_relaxed);
+          continue;
+        }
+        results[i] = column[row];
+      }
+    });
+  }
+  if (missing) {
+    for (int64_t id : id_values) {
+      if (material_row(id) < 0) throw nb::value_error(("Material not found: " + std::to_string(id)).c_str());
+    }
+  }
+  return output.result();
+}
@@ -5,6 +5,9 @@
 #include <nanobind/stl/string.h>
 #include <nanobind/stl/vector.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -38,6 +41,53 @@ std::vector<long> get_ids();
  */
 std::vector<std::string> get_names();
 
+/**
+ * @brief Returns the pyamtrack.materials.Material type.
+ *
+ * The type is imported on the first call and cached for the lifetime of the process (the reference is
+ * never released, as the type outlives all calls), so resolving many Material objects does not import
+ * the module again. Modules resolving materials call it once when they are initialized.
+ */
+inline nb::handle material_type() {
+  static std::atomic<PyObject*> type{nullptr};
+  PyObject* cached = type.load(std::memory_order_acquire);
+  if (!cached) {
+    // Concurrent first calls may both import the module; the type is the same object
+    nb::object material_class = nb::module_::import_("pyamtrack.materials").attr("Material");
+    cached = material_class.release().ptr();
+    type.store(cached, std::memory_order_release);
+  }
+  return cached;
+}
+
+/**
+ * @brief Returns the id of a material given by its full name ("Water, Liquid") or sanitized name
+ * ("water_liquid"), or -1 if there is no such material.
+ *
+ * Names are looked up in a hash table built on the first call.
+ */
+long material_id_from_name(const std::string& name);
+
+/**
+ * @brief Whether a material id is in AT_Material_Data (including the user-defined material of row 0).
+ *
+ * Ids are checked against a table built on the first call, so it is cheap enough for every element of an array
+ * and may be called without the GIL.
+ */
+inline bool is_material_id(int64_t id) {
+  static const std::vector<bool> ids = [] {
+    const AT_table_of_material_data_struct& data = AT_Material_Data;
+    long max_id = 0;
+    for (long row = 0; row < data.n; ++row) max_id = std::max(max_id, data.material_no[row]);
+    std::vector<bool> result(max_id + 1, false);
+    for (long row = 0; row < data.n; ++row) {
+      if (data.material_no[row] >= 0) result[data.material_no[row]] = true;
+    }
+    return result;
+  }();
+  return id >= 0 && id < static_cast<int64_t>(ids.size()) && ids[id];
+}
+
 /**
  * @brief transforms material into its corresponding id. If int is passed as input, then returns input;
  *
@@ -49,10 +99,7 @@ inline int process_material(const nb::object& material) {
     material_id = nb::cast<int>(material);
   } else {
     try {
-      nb::module_ pyamtrack_mod = nb::module_::import_("pyamtrack.materials");
-      nb::object MaterialType = pyamtrack_mod.attr("Material");
-
-      if (!nb::isinstance(material, MaterialType)) {
+      if (!nb::isinstance(material, material_type())) {
         throw nb::type_error("Material argument must be an integer or a pyamtrack.materials.Material object");
       }
 
@@ -82,6 +129,36 @@ inline int process_material(const nb::object& material) {
  */
 std::vector<std::string> get_long_names();
 
+/**
+ * @brief Returns the material table as NumPy arrays, one per column, indexed like get_ids().
+ *
+ * The numeric columns (id, density_g_cm3, I_eV, alpha_g_cm2_MeV, p_MeV, m_g_cm2, average_A, average_Z)
+ * are read-only views of AT_Material_Data, without any copy. The phase and name columns are computed
+ * once (phase) or per call (name, an array of str).
+ *
+ * Example:
+ * >>> table()["density_g_cm3"][:3]
+ * array([1.   , 3.97 , 2.6989])
+ *
+ * @return nb::dict Mapping column names to 1-D arrays of equal length.
+ */
+nb::dict table();
+
+/**
+ * @brief Looks up a numeric column of the material table for one or many materials.
+ *
+ * Materials are resolved to rows of AT_Material_Data through an id index built once, so the lookup of
+ * large id arrays runs without creating Material objects, on the shared thread pool and without the GIL.
+ *
+ * @param material A material id or Material, a list of them, or a NumPy array of integer ids.
+ * @param column   The column of AT_Material_Data to read, e.g. AT_Material_Data.density_g_cm3.
+ * @return nb::object A float for a single material, otherwise a float64 array of the shape of `material`.
+ *
+ * @throws nb::type_error  if `material` is not an id, a Material, a list of them or an integer array.
+ * @throws nb::value_error if a material id is not in the table.
+ */
+nb::object material_property(const nb::object& material, const double* column);
+
 /**
  * @class Material
  * @brief Represents a material with various physical properties.
@@ -133,16 +210,16 @@ class Material {
   Material(long id);
 
   /**
-   * @brief Initializes a Material object using its name.
+   * @brief Initializes a Material object using its full or sanitized name.
    *
    * Example:
    * >>> material = Material("Water, Liquid")
    * >>> material.id
    * 1
-   * >>> material.name
+   * >>> Material("water_liquid").name
    * 'Water, Liquid'
    *
-   * @param name The name of the material.
+   * @param name The name of the material, as returned by get_long_names() or get_names().
    * @throws std::invalid_argument if the material name is not found.
    */
   Material(const std::string& name);
@@ -2,14 +2,16 @@
 #include <nanobind/stl/string.h>
 #include <nanobind/stl/vector.h>
 
+#include <algorithm>
 #include <iostream>
 
 #include "AT_DataMaterial.h"
+#include "../wrapper/module.h"
 #include "materials.h"
 
 namespace nb = nanobind;
 
-NB_MODULE(materials, m) {
+PYAMTRACK_MODULE(materials, m) {
   m.doc() = "Functions and data structures for accessing and manipulating material properties.";
 
   nb::class_<Material>(m, "Material", R"pbdoc(
@@ -80,9 +82,68 @@ NB_MODULE(materials, m) {
             list[str]: A list of sanitized material names.
     )pbdoc");
 
-  // Dynamically expose materials as attributes of the module
-  auto names = get_names();
-  for (size_t i = 0; i < names.size(); ++i) {
-    m.attr(names[i].c_str()) = Material(static_cast<long>(i + 1));
+  m.def("table", &table, R"pbdoc(
+        Returns the whole material table as columns.
+
+        The numeric columns are read-only NumPy arrays viewing the libamtrack material data directly,
+        without copies; row i describes the material get_ids()[i]. Use them to look up properties of
+        many materials at once instead of creating Material objects, or use the accessors named after
+        the Material attributes, e.g. density_g_cm3(ids), which take an id, a Material, a list of them
+        or an integer array of ids and return a float or an array of the same shape.
+
+        Returns:
+            dict[str, numpy.ndarray]: Columns id, density_g_cm3, I_eV, alpha_g_cm2_MeV, p_MeV, m_g_cm2,
+            average_A, average_Z, phase and name.
+    )pbdoc");
+
+  // Vectorized accessors of the numeric Material attributes
+  struct Property {
+    const char* name;
+    const double* column;
+    const char* doc;
+  };
+  const AT_table_of_material_data_struct& data = AT_Material_Data;
+  const Property properties[] = {
+      {"density_g_cm3", data.density_g_cm3, "The density in g/cm³ of one or many materials."},
+      {"I_eV", data.I_eV, "The mean ionization potential in eV of one or many materials."},
+      {"alpha_g_cm2_MeV", data.alpha_g_cm2_MeV, "The power-law stopping power fit parameter alpha of materials."},
+      {"p_MeV", data.p_MeV, "The power-law stopping power fit parameter p of one or many materials."},
+      {"m_g_cm2", data.m_g_cm2, "The linear fluence change fit parameter m of one or many materials."},
+      {"average_A", data.average_A, "The average mass number of one or many materials."},
+      {"average_Z", data.average_Z, "The average atomic number of one or many materials."},
+  };
+  for (const Property& property : properties) {
+    const double* column = property.column;
+    m.def(
+        property.name, [column](const nb::object& material) { return material_property(material, column); },
+        nb::arg("material"), property.doc);
   }
+
+  // Materials are exposed as attributes of the module (e.g. materials.water_liquid), created on first access
+  // through the module __getattr__ (PEP 562) and then stored in the module, so importing it stays cheap
+  const std::string module_name = nb::cast<std::string>(m.attr("__name__"));
+  m.def(
+      "__getattr__",
+      [module_name](const std::string& name) -> nb::object {
+        static const std::vector<std::string> names = get_names();
+        auto it = std::find(names.begin(), names.end(), name);
+        if (it == names.end()) {
+          throw nb::attribute_error(("module '" + module_name + "' has no attribute '" + name + "'").c_str());
+        }
+        nb::object material = nb::cast(Material(static_cast<long>(it - names.begin() + 1)));
+        // Keeps the object stored by a concurrent first access, so that every access returns the same one
+        nb::dict globals = nb::borrow<nb::dict>(nb::module_::import_(module_name.c_str()).attr("__dict__"));
+        PyObject* stored = PyDict_SetDefault(globals.ptr(), nb::str(name.c_str()).ptr(), material.ptr());
+        if (!stored) throw nb::python_error();
+        return nb::borrow(stored);
+      },
+      nb::arg("name"));
+  m.def("__dir__", [module_name]() {
+    nb::dict globals = nb::borrow<nb::dict>(nb::module_::import_(module_name.c_str()).attr("__dict__"));
+    nb::list attributes = nb::steal<nb::list>(PyDict_Keys(globals.ptr()));
+    for (const auto& name : get_names()) {
+      if (!globals.contains(name.c_str())) attributes.append(nb::str(name.c_str()));
+    }
+    return attributes;
+  });
 }
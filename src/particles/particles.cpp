@@ -1,9 +1,57 @@
 #include "particles.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cstdint>
 #include <optional>
 #include <stdexcept>
+#include <unordered_map>
+
+#include "../runtime/thread_pool.h"
+#include "../wrapper/output.h"
+#include "../wrapper/vectorized.h"
+
+namespace {
+
+// Row of AT_Particle_Data for every atomic number, -1 for atomic numbers not in the table
+const std::vector<long>& z_index() {
+  static const std::vector<long> index = [] {
+    const auto& data = AT_Particle_Data;
+    long max_Z = 0;
+    for (long i = 0; i < data.n; ++i) max_Z = std::max(max_Z, data.Z[i]);
+    std::vector<long> result(max_Z + 1, -1);
+    for (long i = 0; i < data.n; ++i) {
+      if (data.Z[i] >= 0 && result[data.Z[i]] < 0) result[data.Z[i]] = i;
+    }
+    return result;
+  }();
+  return index;
+}
+
+long row_from_Z(long Z) {
+  const std::vector<long>& index = z_index();
+  return Z >= 0 && Z < static_cast<long>(index.size()) ? index[Z] : -1;
+}
+
+// Row of AT_Particle_Data for every element acronym
+const std::unordered_map<std::string, long>& acronym_index() {
+  static const std::unordered_map<std::string, long> index = [] {
+    const auto& data = AT_Particle_Data;
+    std::unordered_map<std::string, long> result;
+    for (long i = 0; i < data.n; ++i) result.emplace(data.element_acronym[i], i);
+    return result;
+  }();
+  return index;
+}
+
+long row_from_acronym(const std::string& acronym) {
+  const auto& index = acronym_index();
+  auto it = index.find(acronym);
+  return it == index.end() ? -1 : it->second;
+}
+
+}  // namespace
 
 Particle::Particle(long id) : id(id) {
   if (id < 1 || id > AT_Particle_Data.n) {
@@ -21,15 +69,13 @@ Particle::Particle(long id) : id(id) {
 
 Particle::Particle(const std::string& acronym) {
   const auto& data = AT_Particle_Data;
-  auto it = std::find_if(data.element_acronym, data.element_acronym + data.n,
-                         [&acronym](const char* a) { return acronym == a; });
-
-  if (it == data.element_acronym + data.n) {
+  long row = row_from_acronym(acronym);
+  if (row < 0) {
     throw std::invalid_argument("Particle acronym not found: " + acronym);
   }
 
-  size_t index = std::distance(data.element_acronym, it);
-  id = index + 1;
+  size_t index = static_cast<size_t>(row);
+  id = row + 1;
   Z = data.Z[index];
   atomic_weight = data.atomic_weight[index];
   element_name = std::string(data.element_name[index]);
@@ -47,16 +93,13 @@ Particle Particle::from_number(long particle_no) {
     throw std::invalid_argument("Invalid particle number: " + std::to_string(particle_no));
   }
 
-  const auto& data = AT_Particle_Data;
-  for (int i = 0; i < data.n; ++i) {
-    if (data.Z[i] == Z_candidate) {
-      Particle p(i + 1);
-      p.A = A_candidate;
-      return p;
-    }
+  long row = row_from_Z(Z_candidate);
+  if (row < 0) {
+    throw std::invalid_argument("Particle with Z=" + std::to_string(Z_candidate) + " not found");
   }
-
-  throw std::invalid_argument("Particle with Z=" + std::to_string(Z_candidate) + " not found");
+  Particle p(row + 1);
+  p.A = A_candidate;
+  return p;
 }
 
 /**
@@ -135,3 +178,117 @@ nb::object Particle::py_get_A() const {
     return nb::none();
   }
 }
+
+namespace {
+
+// Z, A and atomic weight arrays of the decoded particles
+struct DecodedParticles {
+  std::vector<size_t> shape;
+  OutputBuffer<int64_t> Z;
+  OutputBuffer<int64_t> A;
+  OutputBuffer<double> atomic_weight;
+
+  explicit DecodedParticles(const std::vector<size_t>& shape)
+      : shape(shape), Z(nb::none(), shape), A(nb::none(), shape), atomic_weight(nb::none(), shape) {}
+
+  nb::dict result() {
+    nb::dict columns;
+    columns["Z"] = Z.result();
+    columns["A"] = A.result();
+    columns["atomic_weight"] = atomic_weight.result();
+    return columns;
+  }
+};
+
+nb::dict decode_numbers(const nb::object& particle_no) {
+  Column column = make_column(particle_no);
+  if (column.kind == Column::Kind::Float64 || column.kind == Column::Kind::Float32) {
+    throw nb::type_error("Particle numbers must be integers.");
+  }
+  const std::vector<int64_t> numbers = gather_column<int64_t>(column);
+  DecodedParticles decoded(column.shape);
+
+  std::atomic<bool> invalid{false};
+  {
+    nb::gil_scoped_release release;
+    int64_t* Z = decoded.Z.data();
+    int64_t* A = decoded.A.data();
+    double* atomic_weight = decoded.atomic_weight.data();
+    parallel_for(numbers.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        long mass_number = AT_A_from_particle_no_single(static_cast<long>(numbers[i]));
+        long row = row_from_Z(static_cast<long>(numbers[i] / 1000));
+        if (mass_number < 0 || row < 0) {
+          invalid.store(true, std::memory_order_relaxed);
+          continue;
+        }
+        Z[i] = AT_Particle_Data.Z[row];
+        A[i] = mass_number;
+        atomic_weight[i] = AT_Particle_Data.atomic_weight[row];
+      }
+    });
+  }
+  if (invalid) {
+    // Report the first invalid number, with the message of Particle.from_number
+    for (int64_t number : numbers) Particle::from_number(static_cast<long>(number));
+  }
+  return decoded.result();
+}
+
+nb::dict decode_strings(const nb::list& names, const std::vector<size_t>& shape) {
+  DecodedParticles decoded(shape);
+  int64_t* Z = decoded.Z.data();
+  int64_t* A = decoded.A.data();
+  double* atomic_weight = decoded.atomic_weight.data();
+
+  size_t i = 0;
+  std::string acronym;
+  for (nb::handle element : names) {
+    Py_ssize_t size = 0;
+    const char* name = nb::isinstance<nb::str>(element) ? PyUnicode_AsUTF8AndSize(element.ptr(), &size) : nullptr;
+    if (!name) {
+      PyErr_Clear();
+      throw nb::type_error("Particle names must be strings.");
+    }
+
+    // Leading digits are the mass number, the rest is the element acronym (as in Particle.from_string)
+    Py_ssize_t pos = 0;
+    int64_t mass_number = 0;
+    while (pos < size && std::isdigit(static_cast<unsigned char>(name[pos]))) {
+      mass_number = std::min<int64_t>(mass_number * 10 + (name[pos] - '0'), INT32_MAX);
+      ++pos;
+    }
+    acronym.assign(name + pos, size - pos);
+    long row = acronym.empty() ? -1 : row_from_acronym(acronym);
+    if (row < 0) throw nb::value_error(("Invalid particle name: " + std::string(name, size)).c_str());
+
+    Z[i] = AT_Particle_Data.Z[row];
+    A[i] = pos > 0 ? mass_number : -1;
+    atomic_weight[i] = AT_Particle_Data.atomic_weight[row];
+    ++i;
+  }
+  return decoded.result();
+}
+
+}  // namespace
+
+nb::dict decode(const nb::object& particles) {
+  if (nb::isinstance<nb::list>(particles)) {
+    nb::list list = nb::borrow<nb::list>(particles);
+    if (nb::len(list) > 0 && nb::isinstance<nb::str>(list[0])) return decode_strings(list, {nb::len(list)});
+    return decode_numbers(particles);
+  }
+  if (nb::isinstance<nb::ndarray<>>(particles)) {
+    if (!check_int_dtype(particles)) throw nb::type_error("Particle numbers must be integers.");
+    return decode_numbers(particles);
+  }
+  // Arrays of names (NumPy str or object arrays) cannot be viewed as ndarrays
+  if (nb::hasattr(particles, "dtype") && nb::hasattr(particles, "ravel")) {
+    std::string kind = nb::cast<std::string>(particles.attr("dtype").attr("kind"));
+    if (kind == "U" || kind == "O") {
+      return decode_strings(nb::borrow<nb::list>(particles.attr("ravel")().attr("tolist")()),
+                            nb::cast<std::vector<size_t>>(particles.attr("shape")));
+    }
+  }
+  throw nb::type_error("particles must be a list or NumPy array of particle numbers or names.");
+}
@@ -37,6 +37,26 @@ std::vector<std::string> get_names();
  */
 std::vector<std::string> get_acronyms();
 
+/**
+ * @brief Decodes many particles at once into arrays of atomic number, mass number and atomic weight.
+ *
+ * Particle numbers (1000*Z + A) are decoded like Particle::from_number and names ("C", "12C") like
+ * Particle::from_string, but without creating Particle objects: elements are found through an index
+ * of the table by atomic number and a hash table of the acronyms. Integer arrays are decoded on the
+ * shared thread pool without the GIL.
+ *
+ * Example:
+ * >>> decode(np.array([1001, 6012]))
+ * {'Z': array([1, 6]), 'A': array([ 1, 12]), 'atomic_weight': array([ 1.00794, 12.0107 ])}
+ *
+ * @param particles A list or NumPy array of integer particle numbers, or of strings.
+ * @return nb::dict Arrays Z (int64), A (int64, -1 for names without mass number) and atomic_weight (float64),
+ *                  of the shape of `particles`.
+ * @throws nb::type_error  if `particles` is not a list or array of integers or strings.
+ * @throws nb::value_error for the first particle number or name which cannot be decoded.
+ */
+nb::dict decode(const nb::object& particles);
+
 /**
  * @class Particle
  * @brief Represents a particle with various physical properties.
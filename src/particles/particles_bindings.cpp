@@ -2,12 +2,15 @@
 #include <nanobind/stl/string.h>
 #include <nanobind/stl/vector.h>
 
+#include <algorithm>
+
 #include "AT_DataParticle.h"
+#include "../wrapper/module.h"
 #include "particles.h"
 
 namespace nb = nanobind;
 
-NB_MODULE(particles, m) {
+PYAMTRACK_MODULE(particles, m) {
   m.doc() = "Functions and data structures for accessing and manipulating particle properties.";
 
   nb::class_<Particle>(m, "Particle", R"pbdoc(
@@ -108,11 +111,64 @@ NB_MODULE(particles, m) {
           list[str]: A list of particle acronyms.
   )pbdoc");
 
-  // Dynamically expose particles as attributes of the module
-  auto names = get_names();
-  auto acronyms = get_acronyms();
-  for (size_t i = 0; i < names.size(); ++i) {
-    m.attr(names[i].c_str()) = Particle(static_cast<long>(i + 1));
-    m.attr(acronyms[i].c_str()) = Particle(static_cast<long>(i + 1));
-  }
+  m.def("decode", &decode, nb::arg("particles"), R"pbdoc(
+      Decodes many particles at once into atomic numbers, mass numbers and atomic weights.
+
+      Particle numbers (1000*Z + A) are decoded like Particle.from_number, and names such as "C" or
+      "12C" like Particle.from_string, in a single pass without creating Particle objects.
+
+      Example:
+          >>> decoded = decode(np.array([1001, 2004, 6012]))
+          >>> decoded["Z"]
+          array([1, 2, 6])
+          >>> decode(["12C", "4He", "O"])["A"]
+          array([12,  4, -1])
+
+      Args:
+          particles (list or numpy.ndarray): Integer particle numbers, or particle names (str).
+
+      Returns:
+          dict[str, numpy.ndarray]: Arrays "Z" (int64), "A" (int64, -1 for names without a mass number)
+          and "atomic_weight" (float64), of the shape of `particles`.
+
+      Raises:
+          TypeError: If the particles are neither integers nor strings.
+          ValueError: If a particle number or name cannot be decoded.
+  )pbdoc");
+
+  // Particles are exposed as attributes of the module by name and acronym (e.g. particles.Carbon, particles.C),
+  // created on first access through the module __getattr__ (PEP 562) and then stored in the module
+  const std::string module_name = nb::cast<std::string>(m.attr("__name__"));
+  m.def(
+      "__getattr__",
+      [module_name](const std::string& name) -> nb::object {
+        static const std::vector<std::string> names = get_names();
+        static const std::vector<std::string> acronyms = get_acronyms();
+        auto it = std::find(names.begin(), names.end(), name);
+        long id = it - names.begin() + 1;
+        if (it == names.end()) {
+          it = std::find(acronyms.begin(), acronyms.end(), name);
+          id = it - acronyms.begin() + 1;
+          if (it == acronyms.end()) {
+            throw nb::attribute_error(("module '" + module_name + "' has no attribute '" + name + "'").c_str());
+          }
+        }
+        nb::object particle = nb::cast(Particle(id));
+        // Keeps the object stored by a concurrent first access, so that every access returns the same one
+        nb::dict globals = nb::borrow<nb::dict>(nb::module_::import_(module_name.c_str()).attr("__dict__"));
+        PyObject* stored = PyDict_SetDefault(globals.ptr(), nb::str(name.c_str()).ptr(), particle.ptr());
+        if (!stored) throw nb::python_error();
+        return nb::borrow(stored);
+      },
+      nb::arg("name"));
+  m.def("__dir__", [module_name]() {
+    nb::dict globals = nb::borrow<nb::dict>(nb::module_::import_(module_name.c_str()).attr("__dict__"));
+    nb::list attributes = nb::steal<nb::list>(PyDict_Keys(globals.ptr()));
+    for (const auto& names : {get_names(), get_acronyms()}) {
+      for (const auto& name : names) {
+        if (!globals.contains(name.c_str())) attributes.append(nb::str(name.c_str()));
+      }
+    }
+    return attributes;
+  });
 }
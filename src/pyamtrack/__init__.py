@@ -27,9 +27,12 @@ if sys.platform == "win32":
         pass
 
     # List of DLLs that _core depends on.
-    dependent_dlls = ["amtrack.dll", "gsl.dll", "gslcblas.dll"]
+    dependent_dlls = ["amtrack.dll", "pyamtrack_runtime.dll", "gsl.dll", "gslcblas.dll"]
     for dll_name in dependent_dlls:
         dll_path = os.path.join(package_dir, dll_name)
+        if not os.path.exists(dll_path):
+            # Linked statically into _core in the single-module build
+            continue
         try:
             ctypes.CDLL(dll_path)
             # print(f"Successfully loaded {dll_name} from {dll_path}")
@@ -37,6 +40,20 @@ if sys.platform == "win32":
             print(f"Warning: failed to load {dll_name} from {dll_path}: {e}")
 
 
-from . import converters, materials, particles, stopping
-
-__all__ = ["converters", "stopping", "materials", "particles"]
+# _core comes first: in the single-module build it registers the other submodules
+from . import _core, converters, materials, parallel, particles, stopping
+from ._core import enable_stats, get_num_threads, reset_stats, set_num_threads, stats, stats_enabled
+
+__all__ = [
+    "converters",
+    "stopping",
+    "materials",
+    "particles",
+    "parallel",
+    "get_num_threads",
+    "set_num_threads",
+    "enable_stats",
+    "stats_enabled",
+    "stats",
+    "reset_stats",
+]
@@ -0,0 +1,335 @@
+"""Evaluation of large pyamtrack calls in several processes.
+
+`map_sharded` splits the output of a vectorized function (e.g. `pyamtrack.stopping.electron_range`) into
+shards along its first axis and evaluates them in worker processes. Large input arrays and the output live
+in `multiprocessing.shared_memory` blocks: the workers read their inputs and write their results in place,
+so no array is ever pickled. The output block also records which shards are complete, so an interrupted
+evaluation can be resumed.
+"""
+
+from __future__ import annotations
+
+import hashlib
+import importlib
+import math
+import os
+import struct
+import sys
+import weakref
+from concurrent.futures import ProcessPoolExecutor
+from multiprocessing import resource_tracker, shared_memory
+
+import numpy as np
+
+__all__ = ["map_sharded"]
+
+# Input arrays with at least this many elements are shared with the workers instead of being pickled
+SHARED_INPUT_ELEMENTS = 4096
+
+# Header of the output block: magic, number of shards, dtype string, hash of the call and number of dimensions,
+# followed by the shape and one status byte per shard
+_MAGIC = b"PYAMSHRD"
+_HEADER = struct.Struct("<8sq16s32sq")
+_SHARD_DONE = 1
+
+
+def _status_offset(ndim):
+    """Offset of the status bytes of the shards in an output block."""
+    return _HEADER.size + 8 * ndim
+
+
+def _header_size(ndim, shards):
+    """Size of the header of an output block, a multiple of 64 bytes so that the data stays aligned."""
+    return (_status_offset(ndim) + shards + 63) // 64 * 64
+
+
+def _call_hash(func, args, cartesian_product, kwargs):
+    """
+    Hash of a call of map_sharded, which tells whether an output block holds its results: the function, the
+    shapes and dtypes of the arguments, the values of those with fewer than SHARED_INPUT_ELEMENTS elements
+    (such as materials or models) and the keyword arguments.
+    """
+    function = _function_reference(func)
+    if not isinstance(function, tuple):
+        function = (getattr(func, "__module__", None), getattr(func, "__qualname__", repr(func)))
+    arguments = []
+    for argument in args:
+        try:
+            array = np.asarray(argument)
+        except ValueError:
+            arguments.append(repr(argument))
+            continue
+        value = array.tolist() if array.size < SHARED_INPUT_ELEMENTS else None
+        arguments.append((array.shape, array.dtype.str, value))
+    call = (function, cartesian_product, arguments, sorted((key, repr(value)) for key, value in kwargs.items()))
+    return hashlib.sha256(repr(call).encode()).digest()
+
+
+def _open_shared_memory(name=None, create=False, size=0, track=True):
+    """
+    Opens (or creates) a shared memory block, optionally unknown to the resource tracker, which removes the
+    blocks it knows when the processes using it exit. Workers attach untracked: they share the tracker of the
+    parent, and their registrations would race with the parent removing the block.
+    """
+    if sys.version_info >= (3, 13):
+        return shared_memory.SharedMemory(name=name, create=create, size=size, track=track)
+    if track or os.name != "posix":
+        return shared_memory.SharedMemory(name=name, create=create, size=size)
+    # Before Python 3.13, SharedMemory always registers the block: skip it for the time of the constructor
+    register = resource_tracker.register
+    resource_tracker.register = lambda name, rtype: None
+    try:
+        return shared_memory.SharedMemory(name=name, create=create, size=size)
+    finally:
+        resource_tracker.register = register
+
+
+def _unlink_shared_memory(block, track=True):
+    """Removes the name of a shared memory block opened by _open_shared_memory."""
+    if sys.version_info < (3, 13) and not track and os.name == "posix":
+        # unlink() unregisters the block from the resource tracker, which must know it
+        resource_tracker.register(block._name, "shared_memory")
+    block.unlink()
+
+
+def _shared_input(argument):
+    """Copies a large numeric array into a new shared memory block, returns None for other arguments."""
+    if isinstance(argument, list):
+        try:
+            array = np.asarray(argument)
+        except ValueError:
+            return None
+    elif isinstance(argument, np.ndarray):
+        array = argument
+    else:
+        return None
+    if array.dtype.kind not in "biuf" or array.size < SHARED_INPUT_ELEMENTS:
+        return None
+    block = _open_shared_memory(create=True, size=array.nbytes)
+    np.ndarray(array.shape, array.dtype, buffer=block.buf)[...] = array
+    return block, (block.name, array.shape, array.dtype.str)
+
+
+def _function_reference(func):
+    """Refers to a module-level function by name, as extension functions cannot be pickled."""
+    module = getattr(func, "__module__", None)
+    name = getattr(func, "__name__", None)
+    if module and name:
+        try:
+            if getattr(importlib.import_module(module), name) is func:
+                return (module, name)
+        except (ImportError, AttributeError):
+            pass
+    return func
+
+
+# State of a worker process, set by _init_worker
+_worker = {}
+
+
+def _init_worker(function, inputs, output, num_threads):
+    import pyamtrack
+
+    if num_threads:
+        pyamtrack.set_num_threads(num_threads)
+    if isinstance(function, tuple):
+        function = getattr(importlib.import_module(function[0]), function[1])
+
+    blocks = []
+    arguments = []
+    for kind, value in inputs:
+        if kind == "shared":
+            name, shape, dtype = value
+            block = _open_shared_memory(name=name, track=False)
+            blocks.append(block)
+            value = np.ndarray(shape, np.dtype(dtype), buffer=block.buf)
+        arguments.append(value)
+
+    name, shape, dtype, shards = output
+    block = _open_shared_memory(name=name, track=False)
+    blocks.append(block)
+    _worker.update(
+        function=function,
+        arguments=arguments,
+        status=np.ndarray((shards,), np.uint8, buffer=block.buf, offset=_status_offset(len(shape))),
+        output=np.ndarray(shape, np.dtype(dtype), buffer=block.buf, offset=_header_size(len(shape), shards)),
+        blocks=blocks,
+    )
+
+
+def _run_shard(shard, begin, end, cartesian_product, kwargs):
+    function = _worker["function"]
+    arguments = _worker["arguments"]
+    output = _worker["output"]
+    if cartesian_product:
+        # The output has the shape (*first argument, *other arguments): a shard is a range of the first argument
+        first = np.reshape(arguments[0], -1)[begin:end]
+        out = output.reshape((-1,) + output.shape[np.ndim(arguments[0]) :])[begin:end]
+        function(first, *arguments[1:], cartesian_product=True, out=out, **kwargs)
+    else:
+        # A shard is a range of the first output axis, along which the arguments spanning it are sliced
+        rows = output.shape[0]
+        sliced = [
+            argument[begin:end] if np.ndim(argument) == output.ndim and np.shape(argument)[0] == rows else argument
+            for argument in arguments
+        ]
+        function(*sliced, out=output[begin:end], **kwargs)
+    _worker["status"][shard] = _SHARD_DONE
+    return shard
+
+
+def _release(block):
+    block.close()
+
+
+def map_sharded(
+    func, *args, cartesian_product=False, workers=None, shards=None, name=None, threads_per_worker=1, **kwargs
+):
+    """
+    Evaluate a vectorized pyamtrack function in several worker processes, into a shared memory output.
+
+    The output is split into shards along its first axis (for a cartesian product, the elements of the first
+    argument), which are evaluated by a pool of worker processes. Input arrays of at least
+    SHARED_INPUT_ELEMENTS numeric elements are copied once into shared memory and the workers write their
+    results directly into a shared output array, so neither inputs nor results are pickled. Other arguments
+    (scalars, short lists, material or model names) and `kwargs` are sent to every worker.
+
+    Parameters
+    ----------
+    func : callable
+        The function to evaluate, which must accept an `out=` array (and `cartesian_product=True` for
+        cartesian products), e.g. pyamtrack.stopping.electron_range or pyamtrack.converters.beta_from_energy.
+        Module-level functions are looked up by name in the workers, others must be picklable.
+    *args
+        The arguments of func, broadcast against each other or combined as a cartesian product.
+    cartesian_product : bool, optional
+        Whether to evaluate the cartesian product of the arguments, as func(..., cartesian_product=True).
+    workers : int, optional
+        Number of worker processes, os.cpu_count() by default.
+    shards : int, optional
+        Number of shards, 8 per worker by default (at most one per row of the first axis).
+        When resuming, the number of shards of the interrupted evaluation is used.
+    name : str, optional
+        Name of the shared memory block of the output. If a block of that name exists, left behind by an
+        interrupted evaluation of the same call, its completed shards are kept and only the others are
+        evaluated. If the evaluation fails, the named block is kept for that purpose (otherwise it is removed).
+        The block records the shape and dtype of the output and a hash of the call (the function, the shapes
+        and dtypes of the arguments, the values of the small ones, and kwargs), which must all match to resume.
+        The contents of large input arrays are not compared.
+    threads_per_worker : int, optional
+        Number of pyamtrack threads in each worker (see pyamtrack.set_num_threads), 1 by default.
+        0 keeps the default of the workers.
+    **kwargs
+        Further keyword arguments of func, e.g. `material`, `model`, `dtype` or `mode`.
+
+    Returns
+    -------
+    numpy.ndarray
+        The results, of the shape func would return. The array is backed by the shared memory block, whose
+        name is removed once complete; the memory is released when the array is garbage collected.
+
+    Raises
+    ------
+    ValueError
+        If the arguments cannot be broadcast together, an existing block `name` holds the output of another call,
+        `kwargs` include out, out_file or where, or select a result which is not a single array (errors="mask").
+
+    Examples
+    --------
+    >>> from pyamtrack.stopping import electron_range
+    >>> ranges = map_sharded(electron_range, np.geomspace(1, 1000, 10**8), [1, 2, 3], cartesian_product=True)
+    """
+    if kwargs.get("errors") == "mask":
+        raise ValueError('map_sharded does not support errors="mask".')
+    for keyword in ("out", "out_file", "where"):
+        if kwargs.get(keyword) is not None:
+            raise ValueError(f"map_sharded allocates and fills the whole output, {keyword} cannot be given.")
+    workers = workers or os.cpu_count() or 1
+    dtype = np.dtype(kwargs.get("dtype") or np.float64)
+
+    shapes = [np.shape(argument) for argument in args]
+    if cartesian_product:
+        if not args or not shapes[0]:
+            raise ValueError("The first argument of a cartesian product must be an array to shard.")
+        shape = tuple(dim for argument_shape in shapes for dim in argument_shape)
+        rows = math.prod(shapes[0])
+    else:
+        shape = np.broadcast_shapes(*shapes)
+        if not shape:
+            # A single element, nothing to shard
+            return func(*args, **kwargs)
+        rows = shape[0]
+    data_size = math.prod(shape) * dtype.itemsize
+    call_hash = _call_hash(func, args, cartesian_product, kwargs)
+
+    # Output block: created, or attached to resume an interrupted evaluation
+    output = None
+    if name is not None:
+        try:
+            output = _open_shared_memory(name=name, track=False)
+        except FileNotFoundError:
+            pass
+    if output is not None:
+        matches = False
+        if output.size >= _HEADER.size:
+            magic, stored_shards, stored_dtype, stored_hash, ndim = _HEADER.unpack_from(output.buf)
+            matches = (
+                magic == _MAGIC
+                and ndim == len(shape)
+                and output.size >= _header_size(ndim, stored_shards) + data_size
+                and tuple(np.frombuffer(output.buf, np.int64, ndim, _HEADER.size)) == shape
+                and stored_dtype.rstrip(b"\0").decode() == dtype.str
+                and stored_hash == call_hash
+                and (shards is None or shards == stored_shards)
+            )
+        if not matches:
+            output.close()
+            raise ValueError(f"Shared memory block {name!r} exists but does not hold the output of this call.")
+        shards = int(stored_shards)
+    else:
+        shards = max(1, min(rows, shards or 8 * workers))
+        header = _header_size(len(shape), shards)
+        # Only an unnamed block is removed by the resource tracker if the process exits before it is complete
+        output = _open_shared_memory(name=name, create=True, size=header + data_size, track=name is None)
+        _HEADER.pack_into(output.buf, 0, _MAGIC, shards, dtype.str.encode(), call_hash, len(shape))
+        np.frombuffer(output.buf, np.int64, len(shape), _HEADER.size)[:] = shape
+        output.buf[_status_offset(len(shape)) : header] = bytes(header - _status_offset(len(shape)))
+
+    status = np.ndarray((shards,), np.uint8, buffer=output.buf, offset=_status_offset(len(shape)))
+    inputs = []
+    input_blocks = []
+    completed = False
+    try:
+        for argument in args:
+            shared = _shared_input(argument) if rows > 1 else None
+            if shared:
+                input_blocks.append(shared[0])
+                inputs.append(("shared", shared[1]))
+            else:
+                inputs.append(("value", argument))
+
+        pending = [shard for shard in range(shards) if status[shard] != _SHARD_DONE]
+        if pending and math.prod(shape) > 0:
+            bounds = [rows * shard // shards for shard in range(shards + 1)]
+            initargs = (_function_reference(func), inputs, (output.name, shape, dtype.str, shards), threads_per_worker)
+            with ProcessPoolExecutor(min(workers, len(pending)), initializer=_init_worker, initargs=initargs) as pool:
+                futures = [
+                    pool.submit(_run_shard, shard, bounds[shard], bounds[shard + 1], cartesian_product, kwargs)
+                    for shard in pending
+                ]
+                for future in futures:
+                    future.result()
+        completed = True
+    finally:
+        del status
+        for block in input_blocks:
+            block.close()
+            block.unlink()
+        if completed or name is None:
+            _unlink_shared_memory(output, track=name is None)
+        if not completed:
+            output.close()
+
+    result = np.ndarray(shape, dtype, buffer=output.buf, offset=_header_size(len(shape), shards))
+    weakref.finalize(result, _release, output)
+    return result
@@ -0,0 +1,190 @@
+#include "npy_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <system_error>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// NumPy format header (magic string, version, header length and the array description),
+// padded with spaces so that the data starts at a multiple of 64 bytes.
+std::string npy_header(const std::string& descr, const std::vector<size_t>& shape) {
+  const uint16_t probe = 1;
+  const char byte_order = *reinterpret_cast<const char*>(&probe) == 1 ? '<' : '>';
+  std::string dict = std::string("{'descr': '") + byte_order + descr + "', 'fortran_order': False, 'shape': (";
+  for (size_t i = 0; i < shape.size(); ++i) {
+    if (i > 0) dict += ", ";
+    dict += std::to_string(shape[i]);
+  }
+  if (shape.size() == 1) dict += ",";
+  dict += "), }";
+
+  // Version 1.0 stores the header length in 2 bytes, version 2.0 in 4 bytes
+  size_t preamble = 10;
+  size_t size = (preamble + dict.size() + 1 + 63) / 64 * 64;
+  if (size - preamble > 0xFFFF) {
+    preamble = 12;
+    size = (preamble + dict.size() + 1 + 63) / 64 * 64;
+  }
+  const size_t header_length = size - preamble;
+
+  std::string header("\x93NUMPY", 6);
+  header += static_cast<char>(preamble == 10 ? 1 : 2);
+  header += '\0';
+  for (size_t i = 0; i < preamble - 8; ++i) header += static_cast<char>((header_length >> (8 * i)) & 0xFF);
+  header += dict;
+  header.append(size - header.size() - 1, ' ');
+  header += '\n';
+  return header;
+}
+
+#if defined(_WIN32)
+std::wstring wide_path(const std::string& path) {
+  int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+  std::wstring result(length > 0 ? length - 1 : 0, L'\0');
+  if (length > 1) MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &result[0], length);
+  return result;
+}
+
+[[noreturn]] void throw_last_error(const std::string& message) {
+  throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), message);
+}
+
+void remove_file(const std::string& path) { DeleteFileW(wide_path(path).c_str()); }
+#else
+[[noreturn]] void throw_errno(const std::string& message) {
+  throw std::system_error(errno, std::generic_category(), message);
+}
+
+void remove_file(const std::string& path) { std::remove(path.c_str()); }
+#endif
+
+}  // namespace
+
+MappedNpyFile::MappedNpyFile(const std::string& path, const std::string& descr, const std::vector<size_t>& shape,
+                             size_t item_size)
+    : path_(path) {
+  const std::string header = npy_header(descr, shape);
+  size_t data_size = item_size;
+  for (size_t dim : shape) data_size *= dim;
+  file_size_ = header.size() + data_size;
+
+  try {
+#if defined(_WIN32)
+    HANDLE file = CreateFileW(wide_path(path).c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                              CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw_last_error("Cannot create " + path);
+    file_ = file;
+
+    // Mapping the file with its final size extends it
+    const uint64_t size = file_size_;
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32),
+                                        static_cast<DWORD>(size & 0xFFFFFFFF), nullptr);
+    if (!mapping) throw_last_error("Cannot reserve " + std::to_string(file_size_) + " bytes for " + path);
+    file_mapping_ = mapping;
+    mapping_ = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0));
+    if (!mapping_) throw_last_error("Cannot map " + path);
+#else
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) throw_errno("Cannot create " + path);
+
+    if (::ftruncate(fd_, static_cast<off_t>(file_size_)) != 0) {
+      throw_errno("Cannot reserve " + std::to_string(file_size_) + " bytes for " + path);
+    }
+#if defined(__linux__)
+    // Allocate the blocks now: a full disk would otherwise only show up as SIGBUS while writing
+    int error = ::posix_fallocate(fd_, 0, static_cast<off_t>(file_size_));
+    if (error != 0 && error != EOPNOTSUPP && error != EINVAL) {
+      errno = error;
+      throw_errno("Cannot reserve " + std::to_string(file_size_) + " bytes for " + path);
+    }
+#endif
+    void* mapping = ::mmap(nullptr, file_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping == MAP_FAILED) throw_errno("Cannot map " + path);
+    mapping_ = static_cast<char*>(mapping);
+#endif
+  } catch (...) {
+    unmap();
+    remove_file(path_);
+    throw;
+  }
+
+  std::copy(header.begin(), header.end(), mapping_);
+  data_ = mapping_ + header.size();
+}
+
+MappedNpyFile::~MappedNpyFile() {
+  if (closed_) return;
+  // Not closed: the call computing the data failed, do not leave an incomplete file behind
+  unmap();
+  remove_file(path_);
+}
+
+void MappedNpyFile::flush(size_t begin, size_t end) {
+  if (!mapping_ || begin >= end) return;
+  size_t first = static_cast<size_t>(data_ - mapping_) + begin;
+  const size_t last = static_cast<size_t>(data_ - mapping_) + end;
+#if defined(_WIN32)
+  FlushViewOfFile(mapping_ + first, last - first);
+#elif defined(__linux__)
+  // msync(MS_ASYNC) does not start any writeback on Linux: start writing this range, then wait for the
+  // previous one, so the range being computed and the one being written are the only dirty pages
+  ::sync_file_range(fd_, static_cast<off_t>(first), static_cast<off_t>(last - first), SYNC_FILE_RANGE_WRITE);
+  if (pending_end_ > pending_begin_) {
+    ::sync_file_range(fd_, static_cast<off_t>(pending_begin_), static_cast<off_t>(pending_end_ - pending_begin_),
+                      SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+  }
+  pending_begin_ = first;
+  pending_end_ = last;
+#else
+  // Elsewhere, the range is written synchronously; msync requires a page-aligned address
+  const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  first -= first % page;
+  ::msync(mapping_ + first, last - first, MS_SYNC);
+#endif
+}
+
+void MappedNpyFile::close() {
+  if (closed_) return;
+#if defined(_WIN32)
+  bool written = FlushViewOfFile(mapping_, 0) && FlushFileBuffers(static_cast<HANDLE>(file_));
+  DWORD error = GetLastError();
+  unmap();
+  closed_ = true;
+  if (!written) throw std::system_error(static_cast<int>(error), std::system_category(), "Cannot write " + path_);
+#else
+  bool written = ::msync(mapping_, file_size_, MS_SYNC) == 0;
+  int error = errno;
+  unmap();
+  closed_ = true;
+  if (!written) throw std::system_error(error, std::generic_category(), "Cannot write " + path_);
+#endif
+}
+
+void MappedNpyFile::unmap() {
+#if defined(_WIN32)
+  if (mapping_) UnmapViewOfFile(mapping_);
+  if (file_mapping_) CloseHandle(static_cast<HANDLE>(file_mapping_));
+  if (file_) CloseHandle(static_cast<HANDLE>(file_));
+  file_mapping_ = nullptr;
+  file_ = nullptr;
+#else
+  if (mapping_) ::munmap(mapping_, file_size_);
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+#endif
+  mapping_ = nullptr;
+  data_ = nullptr;
+}
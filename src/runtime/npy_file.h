@@ -0,0 +1,86 @@
+#ifndef RUNTIME_NPY_FILE_H
+#define RUNTIME_NPY_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Bytes of results computed between two writebacks of a memory-mapped output file.
+ */
+constexpr size_t NPY_FLUSH_BYTES = size_t(64) << 20;
+
+/**
+ * @brief A new .npy file of a given dtype and shape, memory-mapped for writing its data in place.
+ *
+ * The file is created with a NumPy format header (version 1.0, or 2.0 for very long headers) and its
+ * full size is reserved on disk up front, so running out of space is reported here rather than as a
+ * fault while writing the mapping. The data starts at a 64-byte aligned offset, in C order.
+ *
+ * Results are written through data(); flush() writes back a written range, so the page cache does not
+ * accumulate the dirty pages of the whole result. close() waits for all data to be on disk. A file which
+ * is destroyed without being closed is incomplete and is removed.
+ *
+ * The file can be read back at any time after close() with numpy.load(path, mmap_mode="r").
+ */
+class MappedNpyFile {
+ public:
+  /**
+   * @param path      Path of the file, replaced if it exists.
+   * @param descr     NumPy type string of the elements without byte order, e.g. "f8".
+   * @param shape     Shape of the array.
+   * @param item_size Size of one element in bytes.
+   *
+   * @throws std::system_error if the file cannot be created, resized or mapped.
+   */
+  MappedNpyFile(const std::string& path, const std::string& descr, const std::vector<size_t>& shape,
+                size_t item_size);
+  ~MappedNpyFile();
+
+  MappedNpyFile(const MappedNpyFile&) = delete;
+  MappedNpyFile& operator=(const MappedNpyFile&) = delete;
+
+  /** Pointer to the first element of the array. */
+  void* data() const { return data_; }
+
+  /** Path of the file. */
+  const std::string& path() const { return path_; }
+
+  /**
+   * @brief Writes back the data bytes [begin, end) to the file.
+   *
+   * On Linux, the writeback of the range is started with sync_file_range, and the call waits for the range
+   * of the previous call to be written, so at most two ranges of dirty pages exist at any time (the one
+   * being written back and the one being filled next). Elsewhere the range is written synchronously
+   * (msync with MS_SYNC, or FlushViewOfFile on Windows).
+   *
+   * Does not call into Python and may be called without the GIL.
+   */
+  void flush(size_t begin, size_t end);
+
+  /**
+   * @brief Writes back all data, waits for it to reach the disk and unmaps the file.
+   *
+   * @throws std::system_error if the data cannot be written.
+   */
+  void close();
+
+ private:
+  void unmap();
+
+  std::string path_;
+  char* mapping_ = nullptr;  // Start of the mapped file, including the header
+  char* data_ = nullptr;     // Start of the array data in the mapping
+  size_t file_size_ = 0;
+  bool closed_ = false;
+#if defined(_WIN32)
+  void* file_ = nullptr;
+  void* file_mapping_ = nullptr;
+#else
+  int fd_ = -1;
+  size_t pending_begin_ = 0;  // File bytes of the range whose writeback was started by the last flush()
+  size_t pending_end_ = 0;
+#endif
+};
+
+#endif  // RUNTIME_NPY_FILE_H
@@ -0,0 +1,98 @@
+#include "stats.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+bool initial_enabled() {
+  const char* env = std::getenv("PYAMTRACK_STATS");
+  return env && (std::strcmp(env, "1") == 0 || std::strcmp(env, "true") == 0 || std::strcmp(env, "yes") == 0);
+}
+
+std::atomic<bool> enabled{initial_enabled()};
+
+// Innermost call being recorded on this thread
+thread_local StatsCall* current = nullptr;
+
+std::mutex stats_mutex;
+std::map<std::string, FunctionStats> stats;
+
+double seconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+
+}  // namespace
+
+bool stats_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+void set_stats_enabled(bool value) { enabled.store(value, std::memory_order_relaxed); }
+
+std::map<std::string, FunctionStats> collected_stats() {
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  return stats;
+}
+
+void reset_stats() {
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  stats.clear();
+}
+
+void StatsCall::begin() {
+  outer_ = current;
+  current = this;
+  start_ = Clock::now();
+}
+
+void StatsCall::end() {
+  Clock::time_point now = Clock::now();
+  current = outer_;
+
+  double parse_seconds, result_seconds;
+  if (!computed_) {
+    // Failed before computing anything (e.g. invalid arguments)
+    parse_seconds = seconds(now - start_);
+    result_seconds = 0.0;
+  } else {
+    if (last_compute_ < compute_start_) {
+      // An exception interrupted the last compute phase
+      compute_seconds_ += seconds(now - compute_start_);
+      last_compute_ = now;
+    }
+    parse_seconds = seconds(first_compute_ - start_);
+    result_seconds = seconds(now - last_compute_);
+  }
+
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  FunctionStats& entry = stats[function_];
+  entry.calls += 1;
+  entry.elements += elements_;
+  entry.parse_seconds += parse_seconds;
+  entry.compute_seconds += compute_seconds_;
+  entry.result_seconds += result_seconds;
+  entry.allocated_bytes += allocated_bytes_;
+}
+
+void stats_compute_begin() {
+  StatsCall* call = current;
+  if (!call) return;
+  call->compute_start_ = StatsCall::Clock::now();
+  if (!call->computed_) {
+    call->first_compute_ = call->compute_start_;
+    call->computed_ = true;
+  }
+}
+
+void stats_compute_end(size_t elements) {
+  StatsCall* call = current;
+  if (!call) return;
+  call->last_compute_ = StatsCall::Clock::now();
+  call->compute_seconds_ += seconds(call->last_compute_ - call->compute_start_);
+  call->elements_ += elements;
+}
+
+void stats_allocation(size_t bytes) {
+  if (StatsCall* call = current) call->allocated_bytes_ += bytes;
+}
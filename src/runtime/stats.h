@@ -0,0 +1,121 @@
+#ifndef RUNTIME_STATS_H
+#define RUNTIME_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+/**
+ * @brief Statistics collected for one function since the last reset_stats().
+ */
+struct FunctionStats {
+  uint64_t calls = 0;            /**< Number of calls. */
+  uint64_t elements = 0;         /**< Number of results computed (1 for a scalar call). */
+  double parse_seconds = 0.0;    /**< Argument parsing, broadcasting and output allocation. */
+  double compute_seconds = 0.0;  /**< Evaluation of the wrapped function, usually without the GIL. */
+  double result_seconds = 0.0;   /**< Construction of the returned Python object. */
+  uint64_t allocated_bytes = 0;  /**< Bytes allocated for argument conversions, buffers and results. */
+};
+
+/**
+ * @brief Returns whether call statistics are collected.
+ *
+ * Statistics are off by default, or on when the PYAMTRACK_STATS environment variable is "1". The flag
+ * is a relaxed atomic shared by all pyamtrack extension modules, so a disabled call costs one load.
+ */
+bool stats_enabled();
+
+/**
+ * @brief Turns the collection of call statistics on or off.
+ */
+void set_stats_enabled(bool enabled);
+
+/**
+ * @brief Returns the statistics of every function called since the last reset, by function name.
+ */
+std::map<std::string, FunctionStats> collected_stats();
+
+/**
+ * @brief Clears all collected statistics.
+ */
+void reset_stats();
+
+/**
+ * @brief Records one call of a vectorized function into the statistics, when they are enabled.
+ *
+ * Created on the stack of the exported function; the wrappers mark the compute phase of the
+ * innermost active call with stats_compute_begin and stats_compute_end. Time before the first compute
+ * phase is counted as parsing, time after the last one as result construction.
+ *
+ * Only the thread running the call records into it; worker threads of parallel_for are not tracked.
+ */
+class StatsCall {
+ public:
+  /** @param function Name under which the call is recorded, e.g. "stopping.electron_range". */
+  explicit StatsCall(const char* function) : function_(stats_enabled() ? function : nullptr) {
+    if (function_) begin();
+  }
+
+  ~StatsCall() {
+    if (function_) end();
+  }
+
+  StatsCall(const StatsCall&) = delete;
+  StatsCall& operator=(const StatsCall&) = delete;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  void begin();
+  void end();
+
+  friend void stats_compute_begin();
+  friend void stats_compute_end(size_t elements);
+  friend void stats_allocation(size_t bytes);
+
+  const char* function_;
+  StatsCall* outer_ = nullptr;
+  Clock::time_point start_;
+  Clock::time_point compute_start_;
+  Clock::time_point first_compute_;
+  Clock::time_point last_compute_;
+  bool computed_ = false;
+  double compute_seconds_ = 0.0;
+  uint64_t elements_ = 0;
+  uint64_t allocated_bytes_ = 0;
+};
+
+/**
+ * @brief Marks the start of a compute phase of the current call. No-op when no call is recorded.
+ */
+void stats_compute_begin();
+
+/**
+ * @brief Marks the end of a compute phase of the current call, which produced `elements` results.
+ */
+void stats_compute_end(size_t elements);
+
+/**
+ * @brief Adds an allocation of `bytes` to the current call.
+ */
+void stats_allocation(size_t bytes);
+
+/**
+ * @brief Marks a compute phase of the current call for its lifetime (see stats_compute_begin).
+ */
+class StatsComputePhase {
+ public:
+  /** @param elements Number of results computed in this phase. */
+  explicit StatsComputePhase(size_t elements) : elements_(elements) { stats_compute_begin(); }
+  ~StatsComputePhase() { stats_compute_end(elements_); }
+
+  StatsComputePhase(const StatsComputePhase&) = delete;
+  StatsComputePhase& operator=(const StatsComputePhase&) = delete;
+
+ private:
+  size_t elements_;
+};
+
+#endif  // RUNTIME_STATS_H
@@ -0,0 +1,322 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace {
+
+// Part of the index range initially assigned to one thread. The owner and the thieves take chunks
+// from the same atomic cursor, so every chunk is processed exactly once.
+struct alignas(64) Block {
+  std::atomic<size_t> next{0};
+  size_t end = 0;
+};
+
+// A single parallel_for call. Lives on the stack of the calling thread until all workers are done with it.
+struct Job {
+  const std::function<void(size_t, size_t)>& body;
+  std::unique_ptr<Block[]> blocks;
+  size_t num_blocks;
+  size_t chunk;
+  std::atomic<bool> failed{false};
+  std::mutex error_mutex;
+  std::exception_ptr error;
+
+  Job(const std::function<void(size_t, size_t)>& body, size_t n, size_t num_blocks, size_t min_chunk)
+      : body(body), blocks(new Block[num_blocks]), num_blocks(num_blocks) {
+    for (size_t b = 0; b < num_blocks; ++b) {
+      blocks[b].next.store(n * b / num_blocks, std::memory_order_relaxed);
+      blocks[b].end = n * (b + 1) / num_blocks;
+    }
+    // Several chunks per block leave something to steal when threads progress unevenly
+    chunk = std::max(min_chunk, n / (num_blocks * 8));
+  }
+
+  // Processes the own block of a participant first, then steals from the following ones
+  void run(size_t participant) {
+    for (size_t k = 0; k < num_blocks; ++k) {
+      Block& block = blocks[(participant + k) % num_blocks];
+      while (!failed.load(std::memory_order_relaxed)) {
+        size_t begin = block.next.fetch_add(chunk, std::memory_order_relaxed);
+        if (begin >= block.end) break;
+        size_t end = std::min(begin + chunk, block.end);
+        try {
+          body(begin, end);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (!error) error = std::current_exception();
+          failed.store(true, std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+};
+
+struct PoolState {
+  std::atomic<int> num_threads{1};
+  std::atomic<bool> pin_threads{false};
+
+  std::mutex run_mutex;  // held by the caller for the whole duration of a job
+
+  std::mutex mutex;  // guards the fields below
+  std::condition_variable wake;
+  std::condition_variable done;
+  std::vector<std::thread> workers;
+  uint64_t generation = 0;
+  Job* job = nullptr;
+  size_t participants = 0;
+  size_t remaining = 0;
+  bool stop = false;
+};
+
+// Whether this thread is running a part of a job, as a worker or as the caller: nested calls run inline
+thread_local bool in_job = false;
+
+// Marks the calling thread as running a job for its lifetime
+struct InJobScope {
+  InJobScope() { in_job = true; }
+  ~InJobScope() { in_job = false; }
+};
+
+int hardware_threads() {
+  unsigned int count = std::thread::hardware_concurrency();
+  return count > 0 ? static_cast<int>(count) : 1;
+}
+
+void pin_current_thread(size_t cpu) {
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu % static_cast<size_t>(hardware_threads()), &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+  (void)cpu;
+#endif
+}
+
+void worker_loop(PoolState* state, size_t participant) {
+  in_job = true;
+  if (state->pin_threads.load()) pin_current_thread(participant);
+
+  uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(state->mutex);
+  while (true) {
+    state->wake.wait(lock, [&] { return state->stop || state->generation != seen; });
+    if (state->stop) return;
+    seen = state->generation;
+    if (participant >= state->participants) continue;
+
+    Job* job = state->job;
+    lock.unlock();
+    job->run(participant);
+    lock.lock();
+    if (--state->remaining == 0) state->done.notify_one();
+  }
+}
+
+// Must be called with run_mutex held
+void stop_workers(PoolState* state) {
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->stop = true;
+  }
+  state->wake.notify_all();
+  for (auto& worker : state->workers) worker.join();
+  state->workers.clear();
+  state->stop = false;
+}
+
+// Must be called with run_mutex held
+void start_workers(PoolState* state) {
+  size_t wanted = static_cast<size_t>(state->num_threads.load()) - 1;
+  if (state->workers.size() == wanted) return;
+  stop_workers(state);
+  state->generation = 0;
+  for (size_t i = 1; i <= wanted; ++i) state->workers.emplace_back(worker_loop, state, i);
+}
+
+PoolState* create_state(int num_threads, bool pin_threads) {
+  auto* state = new PoolState();
+  state->num_threads = num_threads;
+  state->pin_threads = pin_threads;
+  return state;
+}
+
+PoolState*& pool_state();
+
+#if !defined(_WIN32)
+// The worker threads do not survive fork(), so the child process starts over with an empty pool.
+// The state of the parent is left untouched: its mutexes may have been locked at the time of the fork.
+void reset_after_fork() {
+  PoolState*& state = pool_state();
+  state = create_state(state->num_threads.load(), state->pin_threads.load());
+}
+#endif
+
+PoolState* create_initial_state() {
+  int num_threads = hardware_threads();
+  if (const char* env = std::getenv("PYAMTRACK_NUM_THREADS")) {
+    int value = std::atoi(env);
+    if (value > 0) num_threads = value;
+  }
+  bool pin_threads = false;
+  if (const char* env = std::getenv("PYAMTRACK_PIN_THREADS")) {
+    pin_threads = std::strcmp(env, "1") == 0 || std::strcmp(env, "true") == 0 || std::strcmp(env, "yes") == 0;
+  }
+#if !defined(_WIN32)
+  pthread_atfork(nullptr, nullptr, reset_after_fork);
+#endif
+  return create_state(num_threads, pin_threads);
+}
+
+// The pool is intentionally never destroyed: joining threads from static destructors at process exit
+// is unsafe on some platforms, and idle workers are simply terminated together with the process.
+PoolState*& pool_state() {
+  static PoolState* state = create_initial_state();
+  return state;
+}
+
+// Background threads of submit_task, started on demand and then kept waiting for tasks
+struct TaskQueue {
+  std::mutex mutex;  // guards the fields below
+  std::condition_variable wake;
+  std::condition_variable idle;
+  std::deque<std::function<void()>> tasks;
+  size_t threads = 0;
+  size_t waiting = 0;  // threads waiting for a task
+  size_t running = 0;  // tasks being run
+};
+
+TaskQueue*& task_queue();
+
+void task_loop(TaskQueue* queue) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  while (true) {
+    ++queue->waiting;
+    queue->wake.wait(lock, [&] { return !queue->tasks.empty(); });
+    --queue->waiting;
+    std::function<void()> task = std::move(queue->tasks.front());
+    queue->tasks.pop_front();
+    ++queue->running;
+    lock.unlock();
+    task();
+    task = nullptr;
+    lock.lock();
+    if (--queue->running == 0 && queue->tasks.empty()) queue->idle.notify_all();
+  }
+}
+
+#if !defined(_WIN32)
+// As for the pool, the child process of a fork() starts over without background threads
+void reset_tasks_after_fork() { task_queue() = new TaskQueue(); }
+#endif
+
+// Never destroyed, like the pool: background threads are terminated together with the process
+TaskQueue*& task_queue() {
+  static TaskQueue* queue = [] {
+#if !defined(_WIN32)
+    pthread_atfork(nullptr, nullptr, reset_tasks_after_fork);
+#endif
+    return new TaskQueue();
+  }();
+  return queue;
+}
+
+}  // namespace
+
+void set_num_threads(int num_threads, bool pin_threads) {
+  if (num_threads < 0) {
+    throw std::invalid_argument("Number of threads must be non-negative, got " + std::to_string(num_threads));
+  }
+  PoolState* state = pool_state();
+  std::lock_guard<std::mutex> run_lock(state->run_mutex);
+  stop_workers(state);
+  state->num_threads = num_threads == 0 ? hardware_threads() : num_threads;
+  state->pin_threads = pin_threads;
+}
+
+int get_num_threads() { return pool_state()->num_threads.load(); }
+
+bool get_pin_threads() { return pool_state()->pin_threads.load(); }
+
+void parallel_for(size_t n, const std::function<void(size_t, size_t)>& body, size_t min_chunk) {
+  if (n == 0) return;
+  min_chunk = std::max<size_t>(min_chunk, 1);
+
+  PoolState* state = pool_state();
+  size_t participants = std::min(static_cast<size_t>(state->num_threads.load()), n / min_chunk);
+  if (participants <= 1 || in_job) {
+    body(0, n);
+    return;
+  }
+
+  // Another thread is using the pool: rather than waiting for it, compute on this thread
+  std::unique_lock<std::mutex> run_lock(state->run_mutex, std::try_to_lock);
+  if (!run_lock.owns_lock()) {
+    body(0, n);
+    return;
+  }
+
+  start_workers(state);
+  participants = std::min(participants, state->workers.size() + 1);
+
+  Job job(body, n, participants, min_chunk);
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->job = &job;
+    state->participants = participants;
+    state->remaining = participants - 1;
+    ++state->generation;
+  }
+  state->wake.notify_all();
+
+  {
+    // A nested parallel_for of body on this thread must not lock run_mutex again
+    InJobScope scope;
+    job.run(0);
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&] { return state->remaining == 0; });
+    state->job = nullptr;
+  }
+
+  if (job.error) std::rethrow_exception(job.error);
+}
+
+void submit_task(std::function<void()> task) {
+  TaskQueue* queue = task_queue();
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  queue->tasks.push_back(std::move(task));
+  if (queue->waiting < queue->tasks.size() && queue->threads < static_cast<size_t>(get_num_threads())) {
+    std::thread(task_loop, queue).detach();
+    ++queue->threads;
+  }
+  queue->wake.notify_one();
+}
+
+void wait_tasks() {
+  TaskQueue* queue = task_queue();
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  queue->idle.wait(lock, [&] { return queue->running == 0 && queue->tasks.empty(); });
+}
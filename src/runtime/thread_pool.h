@@ -0,0 +1,76 @@
+#ifndef RUNTIME_THREAD_POOL_H
+#define RUNTIME_THREAD_POOL_H
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * @brief Smallest number of elements handed to a single thread by parallel_for.
+ *
+ * Outputs shorter than two chunks are evaluated on the calling thread, as the cost of waking up
+ * the workers would exceed the cost of the computation itself.
+ */
+constexpr size_t PARALLEL_MIN_CHUNK = 4096;
+
+/**
+ * @brief Sets the number of threads used to evaluate vectorized functions.
+ *
+ * The thread pool is shared by all pyamtrack extension modules of the process. The calling thread
+ * always takes part in the computation, so `num_threads - 1` worker threads are started (lazily, on the
+ * first large call). The initial values are taken from the PYAMTRACK_NUM_THREADS and
+ * PYAMTRACK_PIN_THREADS environment variables.
+ *
+ * @param num_threads Number of threads, 0 selects the number of hardware threads.
+ * @param pin_threads Whether to pin worker threads to consecutive CPU cores (Linux only, ignored elsewhere).
+ * @throws std::invalid_argument if num_threads is negative.
+ */
+void set_num_threads(int num_threads, bool pin_threads = false);
+
+/**
+ * @brief Returns the number of threads used to evaluate vectorized functions.
+ */
+int get_num_threads();
+
+/**
+ * @brief Returns whether worker threads are pinned to CPU cores.
+ */
+bool get_pin_threads();
+
+/**
+ * @brief Evaluates body over the index range [0, n) using the shared thread pool.
+ *
+ * The range is split into one contiguous block per thread. Each thread processes its own block in chunks
+ * of at least `min_chunk` elements, and threads which run out of work steal the remaining chunks of the
+ * other blocks, so uneven per-element costs do not leave cores idle. The call returns once every index
+ * has been processed. If body throws, the remaining chunks are skipped and the first exception is
+ * rethrown in the calling thread.
+ *
+ * Small ranges, nested calls from inside body (on a worker or on the calling thread) and calls made while
+ * the pool is busy with another caller are evaluated directly on the calling thread.
+ *
+ * body must not call into the Python C API: it runs on threads which do not hold the GIL.
+ *
+ * @param n         Number of indices to process.
+ * @param body      Callable invoked as body(begin, end) on disjoint sub-ranges covering [0, n).
+ * @param min_chunk Smallest number of indices processed in one call of body.
+ */
+void parallel_for(size_t n, const std::function<void(size_t, size_t)>& body, size_t min_chunk = PARALLEL_MIN_CHUNK);
+
+/**
+ * @brief Runs task on one of the background threads of pyamtrack and returns immediately.
+ *
+ * Background threads run whole calls submitted through the asynchronous API (e.g. electron_range_async).
+ * They are separate from the parallel_for pool: a task uses the pool when it is free and otherwise
+ * computes on its background thread, so several tasks progress at once. Up to get_num_threads()
+ * background threads are started on demand; further tasks wait for one of them, in submission order.
+ *
+ * task must not throw. It starts without the GIL.
+ */
+void submit_task(std::function<void()> task);
+
+/**
+ * @brief Blocks until every task submitted so far is finished.
+ */
+void wait_tasks();
+
+#endif  // RUNTIME_THREAD_POOL_H
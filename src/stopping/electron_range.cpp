@@ -1,14 +1,18 @@
 #include "electron_range.h"
 
-#include <stdexcept>  // For std::runtime_error
-#include <string>     // For std::string
-#include <vector>     // For std::vector
+#include <algorithm>      // For std::min
+#include <limits>         // For std::numeric_limits
+#include <stdexcept>      // For std::runtime_error
+#include <string>         // For std::string
+#include <unordered_map>  // For std::unordered_map
+#include <vector>         // For std::vector
 
-#include "../wrapper/cartesian_product.h"
-#include "../wrapper/multi_argument.h"
+#include "../wrapper/errors.h"
+#include "../wrapper/vectorized.h"
+#include "range_table.h"
 
 extern "C" {
-#include "AT_ElectronRange.h"  // Contains AT_max_electron_range_m definition
+#include "AT_ElectronRange.h"  // Contains AT_max_electron_range_m and AT_max_electron_ranges_m definitions
 }
 using ids_getter = std::function<int(const nb::object&)>;
 
@@ -45,40 +49,708 @@ int process_model(const nb::object& model) {
   return model_id;
 }
 
+/**
+ * Resolves material or model arguments to ids.
+ *
+ * Integer arrays are returned as is, and single values as a Python int. Lists and NumPy str or object
+ * arrays are converted in one pass into a contiguous int32 array of their shape: ints are taken as ids,
+ * other elements (names, Material objects) are resolved with `getter` once per distinct value within
+ * the call, so long categorical columns only resolve each category once.
+ */
 nb::object get_id(const nb::object& object, const ids_getter& getter) {
+  if (check_int_dtype(object)) return object;
+  if (nb::isinstance<nb::ndarray<>>(object)) throw nb::type_error("numpy arrays of type other than int unsupported");
+
+  nb::list elements;
+  std::vector<size_t> shape;
   if (nb::isinstance<nb::list>(object)) {
-    auto list = nb::cast<nb::list>(object);
-    nb::list id;
-    for (int i = 0; i < nb::len(list); i++) {
-      id.append(getter(nb::cast(list[i])));
-    }
-    return nb::cast(id);
-  } else if (check_int_dtype(object)) {
-    return object;
-  } else if (nb::isinstance<nb::ndarray<>>(object)) {
-    throw nb::type_error("numpy arrays of type other than int unsupported");
+    elements = nb::borrow<nb::list>(object);
+    shape = {nb::len(elements)};
+  } else if (nb::hasattr(object, "dtype") && nb::hasattr(object, "ravel")) {
+    // NumPy str and object arrays cannot be viewed as ndarrays
+    std::string kind = nb::cast<std::string>(object.attr("dtype").attr("kind"));
+    if (kind != "U" && kind != "O") throw nb::type_error("numpy arrays of type other than int unsupported");
+    elements = nb::borrow<nb::list>(object.attr("ravel")().attr("tolist")());
+    shape = nb::cast<std::vector<size_t>>(object.attr("shape"));
   } else {
-    int id = getter(object);
-    return nb::cast(id);
+    return nb::cast(getter(object));
+  }
+
+  OutputBuffer<int32_t> ids(nb::none(), shape);
+  int32_t* data = ids.data();
+  std::unordered_map<std::string, int> names;  // Names resolved in this call
+  std::unordered_map<PyObject*, int> objects;  // Other objects resolved in this call, alive as long as elements
+  size_t i = 0;
+  for (nb::handle element : elements) {
+    PyObject* ptr = element.ptr();
+    if (PyLong_Check(ptr)) {
+      data[i++] = nb::cast<int>(element);
+    } else if (PyUnicode_Check(ptr)) {
+      Py_ssize_t size = 0;
+      const char* utf8 = PyUnicode_AsUTF8AndSize(ptr, &size);
+      if (!utf8) throw nb::python_error();
+      std::string name(utf8, size);
+      auto it = names.find(name);
+      if (it == names.end()) it = names.emplace(std::move(name), getter(nb::borrow(element))).first;
+      data[i++] = it->second;
+    } else if (PyIndex_Check(ptr) && !PyBool_Check(ptr)) {
+      // NumPy integer scalars, e.g. from object arrays
+      data[i++] = nb::cast<int>(nb::steal(PyNumber_Index(ptr)));
+    } else {
+      auto it = objects.find(ptr);
+      if (it == objects.end()) it = objects.emplace(ptr, getter(nb::borrow(element))).first;
+      data[i++] = it->second;
+    }
   }
+  return ids.result();
+}
+
+/**
+ * Error code of one element of electron_range, ERROR_NONE if its range can be computed.
+ */
+uint8_t electron_range_error(double energy_MeV, int64_t material, int64_t model) {
+  if (!(energy_MeV >= 0)) return ERROR_INVALID_ENERGY;
+  if (!is_material_id(material)) return ERROR_INVALID_MATERIAL;
+  if (!is_model_id(model)) return ERROR_INVALID_MODEL;
+  return ERROR_NONE;
+}
+
+/**
+ * Result of an invalid element, whatever the error policy: the loops computing the results store it themselves,
+ * so no per-element state is needed to exclude invalid elements.
+ */
+constexpr double INVALID_RESULT = std::numeric_limits<double>::quiet_NaN();
+
+/**
+ * AT_max_electron_range_m, INVALID_RESULT for a negative or NaN energy or an unknown material or model ID.
+ */
+double checked_max_electron_range_m(double energy_MeV, int material, int model) {
+  if (electron_range_error(energy_MeV, material, model) != ERROR_NONE) return INVALID_RESULT;
+  return AT_max_electron_range_m(energy_MeV, material, model);
+}
+
+/**
+ * Message of the ValueError raised for an element with an unknown material or model ID with errors="raise".
+ */
+std::string id_error_message(uint8_t code, int64_t material, int64_t model, size_t index) {
+  std::string element = " (element " + std::to_string(index) + " of the result).";
+  if (code == ERROR_INVALID_MATERIAL) return "Invalid material ID: " + std::to_string(material) + element;
+  return "Invalid model ID: " + std::to_string(model) + element;
+}
+
+/**
+ * Cartesian product of energies, materials and models, evaluated with one batched libamtrack call
+ * (AT_max_electron_ranges_m) per (material, model) pair and block of energies.
+ *
+ * The energies are gathered once into a contiguous double array shared by all pairs; the ranges of
+ * a block are computed into a temporary buffer and scattered into the output, whose layout is
+ * (energy axes..., material axes..., model axes...). When writing to a file, the energies are processed
+ * in consecutive slices, so the file is filled from start to end. Pairs with an invalid material or
+ * model are not evaluated, their elements and those of invalid energies get INVALID_RESULT.
+ */
+nb::object electron_range_cartesian_product(const std::vector<Column>& columns, const BroadcastLayout& layout,
+                                            const nb::object& out, const nb::object& where, const nb::object& dtype,
+                                            const nb::object& out_file) {
+  return dispatch_output_dtype(dtype, out, [&](auto output_type) {
+    using Out = typename decltype(output_type)::type;
+    if (layout.size == 0) {
+      // Empty result, like for any other cartesian product with an empty argument
+      OutputBuffer<Out> empty(out, {0}, out_file);
+      return empty.result();
+    }
+
+    OutputBuffer<Out> output(out, layout.shape, out_file);
+    WhereMask mask = make_where_mask(where, layout.shape);
+
+    // Energies are used as is when they already are a contiguous float64 array
+    std::vector<double> gathered_energies;
+    const double* energies = static_cast<const double*>(columns[0].data);
+    BroadcastLayout energy_layout = column_layout(columns[0]);
+    if (columns[0].kind != Column::Kind::Float64 || !energy_layout.flat ||
+        (energy_layout.size > 1 && energy_layout.flat_step[0] != 1)) {
+      gathered_energies = gather_column<double>(columns[0]);
+      energies = gathered_energies.data();
+    }
+    const std::vector<int> materials = gather_column<int>(columns[1]);
+    const std::vector<int> models = gather_column<int>(columns[2]);
+
+    const size_t num_pairs = materials.size() * models.size();
+
+    try {
+      StatsComputePhase phase(layout.size);
+      nb::gil_scoped_release release;
+      Out* results = output.data();
+      const bool fill_masked = !output.is_user_provided();
+      output.fill_in_order(layout.size, num_pairs, [&](size_t first_result, size_t last_result) {
+        // The results [first_result, last_result) are those of the energies [first_energy, last_energy)
+        const size_t first_energy = first_result / num_pairs;
+        const size_t last_energy = last_result / num_pairs;
+        const size_t num_blocks = (last_energy - first_energy + PARALLEL_MIN_CHUNK - 1) / PARALLEL_MIN_CHUNK;
+
+        // One task per (material, model) pair and block of energies
+        parallel_for(
+            num_pairs * num_blocks,
+            [&](size_t begin, size_t end) {
+              std::vector<double> ranges(std::min(PARALLEL_MIN_CHUNK, last_energy - first_energy));
+              for (size_t task = begin; task < end; ++task) {
+                size_t pair = task / num_blocks;
+                size_t first = first_energy + (task % num_blocks) * PARALLEL_MIN_CHUNK;
+                size_t count = std::min(PARALLEL_MIN_CHUNK, last_energy - first);
+                int material = materials[pair / models.size()];
+                int model = models[pair % models.size()];
+
+                const bool pair_valid = is_material_id(material) && is_model_id(model);
+                if (pair_valid) {
+                  AT_max_electron_ranges_m(static_cast<long>(count), energies + first, material, model,
+                                           ranges.data());
+                }
+
+                // Output index of energy e for this pair is e * num_pairs + pair
+                WhereCursor selected(mask, first * num_pairs + pair, num_pairs);
+                for (size_t e = 0; e < count; ++e) {
+                  size_t i = (first + e) * num_pairs + pair;
+                  if (selected.next()) {
+                    const bool valid = pair_valid && energies[first + e] >= 0;
+                    results[i] = static_cast<Out>(valid ? ranges[e] : INVALID_RESULT);
+                  } else if (fill_masked) {
+                    results[i] = static_cast<Out>(MASKED_VALUE);
+                  }
+                }
+              }
+            },
+            1);
+      });
+    } catch (const std::exception& e) {
+      throw std::runtime_error("Error processing NumPy array: " + std::string(e.what()));
+    }
+
+    return output.result();
+  });
+}
+
+/**
+ * Returns the cached table of a (material, model) pair for a scalar call, building it without the GIL on first
+ * use, as a first build evaluates the model many times.
+ */
+std::shared_ptr<const RangeTable> fetch_range_table(int material, int model) {
+  StatsComputePhase phase(0);
+  nb::gil_scoped_release release;
+  return get_range_table(material, model);
+}
+
+/**
+ * Returns the cached tables of the valid (material, model) pairs occurring in the output of a layout, building
+ * the missing ones without the GIL: every combination of the distinct materials and models for a cartesian
+ * product, and only the pairs of broadcast elements otherwise.
+ */
+std::vector<std::shared_ptr<const RangeTable>> fetch_range_tables(const std::vector<Column>& columns,
+                                                                  const BroadcastLayout& layout,
+                                                                  bool cartesian_product) {
+  std::vector<std::pair<int, int>> pairs;
+  if (layout.size == 0) return {};
+  if (cartesian_product) {
+    std::vector<int> materials = gather_column<int>(columns[1]);
+    std::vector<int> models = gather_column<int>(columns[2]);
+    std::sort(materials.begin(), materials.end());
+    materials.erase(std::unique(materials.begin(), materials.end()), materials.end());
+    std::sort(models.begin(), models.end());
+    models.erase(std::unique(models.begin(), models.end()), models.end());
+    for (int material : materials) {
+      for (int model : models) pairs.emplace_back(material, model);
+    }
+  }
+
+  std::vector<std::shared_ptr<const RangeTable>> tables;
+  // Building missing tables counts as computation in the call statistics
+  StatsComputePhase phase(0);
+  nb::gil_scoped_release release;
+  if (!cartesian_product) {
+    // Drop the axes along which only the energies vary, they just repeat the pairs of the other axes
+    BroadcastLayout pair_layout;
+    pair_layout.strides.resize(2);
+    for (size_t axis = 0; axis < layout.shape.size(); ++axis) {
+      if (layout.strides[1][axis] == 0 && layout.strides[2][axis] == 0) continue;
+      pair_layout.shape.push_back(layout.shape[axis]);
+      pair_layout.strides[0].push_back(layout.strides[1][axis]);
+      pair_layout.strides[1].push_back(layout.strides[2][axis]);
+    }
+    finish_layout(pair_layout);
+    for_each_broadcast(pair_layout, 0, pair_layout.size, [&](size_t, const std::vector<int64_t>& offsets) {
+      std::pair<int, int> pair(column_value<int>(columns[1], offsets[0]), column_value<int>(columns[2], offsets[1]));
+      if (pairs.empty() || pairs.back() != pair) pairs.push_back(pair);
+    });
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+  }
+  for (const auto& [material, model] : pairs) {
+    if (is_material_id(material) && is_model_id(model)) tables.push_back(get_range_table(material, model));
+  }
+  return tables;
+}
+
+/**
+ * electron_range with mode="table": every element is interpolated in the cached table of its
+ * (material, model) pair. The tables of all valid pairs appearing in the arguments are fetched (and built
+ * if needed) before the evaluation, without the GIL; elements of invalid pairs (there are none when `ids_valid`)
+ * and invalid energies get INVALID_RESULT.
+ */
+nb::object electron_range_table(const std::vector<Column>& columns, const BroadcastLayout& layout,
+                                bool cartesian_product, bool ids_valid, const nb::object& out,
+                                const nb::object& where, const nb::object& dtype, const nb::object& out_file) {
+  const std::vector<std::shared_ptr<const RangeTable>> tables = fetch_range_tables(columns, layout, cartesian_product);
+
+  return dispatch_output_dtype(dtype, out, [&](auto output_type) {
+    using Out = typename decltype(output_type)::type;
+    if (cartesian_product && layout.size == 0) {
+      OutputBuffer<Out> empty(out, {0}, out_file);
+      return empty.result();
+    }
+
+    OutputBuffer<Out> output(out, layout.shape, out_file);
+    WhereMask mask = make_where_mask(where, layout.shape);
+
+    try {
+      StatsComputePhase phase(layout.size);
+      nb::gil_scoped_release release;
+      Out* results = output.data();
+      const bool fill_masked = !output.is_user_provided();
+      auto fill = [&](size_t begin, size_t end) {
+        size_t hint = 0;
+
+        // Common case: a single valid pair and a float64 energy array read in order
+        if (ids_valid && tables.size() == 1 && layout.flat && columns[0].kind == Column::Kind::Float64) {
+          const RangeTable& table = *tables[0];
+          const double* energies = static_cast<const double*>(columns[0].data);
+          const int64_t step = layout.flat_step[0];
+          WhereCursor selected(mask, begin);
+          for (size_t i = begin; i < end; ++i) {
+            if (selected.next()) {
+              const double energy = energies[step * static_cast<int64_t>(i)];
+              results[i] = static_cast<Out>(energy >= 0 ? table.lookup(energy, hint) : INVALID_RESULT);
+            } else if (fill_masked) {
+              results[i] = static_cast<Out>(MASKED_VALUE);
+            }
+          }
+          return;
+        }
+
+        // Table of the pair of the previous element, nullptr for an invalid pair
+        const RangeTable* table = nullptr;
+        bool has_pair = false;
+        int pair_material = 0, pair_model = 0;
+        WhereCursor selected(mask, begin);
+        for_each_broadcast(layout, begin, end, [&](size_t i, const std::vector<int64_t>& offsets) {
+          if (!selected.next()) {
+            if (fill_masked) results[i] = static_cast<Out>(MASKED_VALUE);
+            return;
+          }
+          int material = column_value<int>(columns[1], offsets[1]);
+          int model = column_value<int>(columns[2], offsets[2]);
+          if (!has_pair || material != pair_material || model != pair_model) {
+            has_pair = true;
+            pair_material = material;
+            pair_model = model;
+            table = nullptr;
+            for (const auto& candidate : tables) {
+              if (candidate->material() == material && candidate->model() == model) table = candidate.get();
+            }
+            hint = 0;
+          }
+          const double energy = column_value<double>(columns[0], offsets[0]);
+          results[i] = static_cast<Out>(table && energy >= 0 ? table->lookup(energy, hint) : INVALID_RESULT);
+        });
+      };
+      output.fill_in_order(layout.size, 1, [&](size_t first, size_t last) {
+        parallel_for(last - first, [&](size_t begin, size_t end) { fill(first + begin, first + end); });
+      });
+    } catch (const std::exception& e) {
+      throw std::runtime_error("Error processing NumPy array: " + std::string(e.what()));
+    }
+
+    return output.result();
+  });
+}
+
+/**
+ * Whether every material and model ID of the columns is known, scanning them without the GIL.
+ */
+bool ids_valid(const std::vector<Column>& columns) {
+  nb::gil_scoped_release release;
+  return column_all_of<int64_t>(columns[1], is_material_id) && column_all_of<int64_t>(columns[2], is_model_id);
+}
+
+/**
+ * Validation pass of electron_range and energy_from_electron_range over their (value, material, model) columns,
+ * the value being an energy or a range, which must be non-negative.
+ *
+ * The computation stores INVALID_RESULT for the invalid elements itself, so this pass only applies the error
+ * policy, scanning the elements without the GIL:
+ * - ErrorPolicy::Raise: if some id is unknown (`ids_valid` is false), a ValueError is raised for the first
+ *   element with an unknown id which is not excluded by `where`. Negative or NaN values are not errors.
+ * - ErrorPolicy::Mask: the uint8 error codes of the output elements are returned, ERROR_NONE where excluded.
+ * - ErrorPolicy::Nan: nothing is checked.
+ *
+ * @return The error codes with ErrorPolicy::Mask, an invalid object otherwise.
+ */
+nb::object check_elements(const std::vector<Column>& columns, const BroadcastLayout& layout,
+                          const nb::object& where, ErrorPolicy policy, bool ids_valid) {
+  auto element_code = [&](double value, const std::vector<int64_t>& offsets) {
+    return electron_range_error(value, column_value<int64_t>(columns[1], offsets[1]),
+                                column_value<int64_t>(columns[2], offsets[2]));
+  };
+
+  if (policy == ErrorPolicy::Raise && !ids_valid) {
+    WhereMask mask = make_where_mask(where, layout.shape);
+    size_t first = layout.size;
+    {
+      nb::gil_scoped_release release;
+      first = compute_error_codes(layout, mask, nullptr, [&](const std::vector<int64_t>& offsets) {
+        return element_code(0.0, offsets);
+      });
+    }
+    if (first < layout.size) {
+      BroadcastIterator it(layout, first);
+      const int64_t material = column_value<int64_t>(columns[1], it.offsets()[1]);
+      const int64_t model = column_value<int64_t>(columns[2], it.offsets()[2]);
+      throw nb::value_error(
+          id_error_message(electron_range_error(0.0, material, model), material, model, first).c_str());
+    }
+  }
+  if (policy != ErrorPolicy::Mask) return nb::object();
+
+  WhereMask mask = make_where_mask(where, layout.shape);
+  OutputBuffer<uint8_t> codes(nb::none(), layout.shape);
+  uint8_t* data = codes.data();
+  {
+    nb::gil_scoped_release release;
+    if (ids_valid && column_all_of<double>(columns[0], [](double value) { return value >= 0; })) {
+      std::fill_n(data, layout.size, ERROR_NONE);
+    } else {
+      compute_error_codes(layout, mask, data, [&](const std::vector<int64_t>& offsets) {
+        return element_code(column_value<double>(columns[0], offsets[0]), offsets);
+      });
+    }
+  }
+  return codes.result();
 }
 
 nb::object electron_range(const nb::object& energy_MeV, const nb::object& material, const nb::object& model,
-                          const bool cartesian_product) {
+                          const bool cartesian_product, const nb::object& out, const nb::object& where,
+                          const nb::object& dtype, const std::string& mode, const nb::object& out_file,
+                          const std::string& errors) {
+  StatsCall call("stopping.electron_range");
+  if (mode != "exact" && mode != "table") {
+    throw nb::value_error(("mode must be \"exact\" or \"table\", got \"" + mode + "\".").c_str());
+  }
+  if (!out_file.is_none() && !cartesian_product) {
+    throw nb::value_error("out_file is only supported together with cartesian_product=True.");
+  }
+  const ErrorPolicy policy = parse_error_policy(errors);
   std::vector<nb::object> arguments_vector;
   arguments_vector.push_back(energy_MeV);
   arguments_vector.push_back(get_id(material, process_material));  // unifying materials to int
   arguments_vector.push_back(get_id(model, process_model));        // unifying models to int
-  auto electron_range_vector = [](const std::vector<std::variant<double, int>>& vec) -> double {
-    if (vec.size() < 3) {
-      throw std::invalid_argument("Input vector must have at least three elements.");
+
+  // Scalar arguments give a Python float
+  bool scalars_only = !cartesian_product && out.is_none() && where.is_none() && dtype.is_none();
+  for (const auto& argument : arguments_vector) {
+    scalars_only = scalars_only && (PyFloat_Check(argument.ptr()) || PyLong_Check(argument.ptr()));
+  }
+  if (scalars_only) {
+    const double energy = nb::cast<double>(arguments_vector[0]);
+    const int material_id = nb::cast<int>(arguments_vector[1]);
+    const int model_id = nb::cast<int>(arguments_vector[2]);
+    const uint8_t code = electron_range_error(energy, material_id, model_id);
+    // With errors="raise" only the ids are checked, a negative or NaN energy gives NaN
+    const uint8_t id_code = electron_range_error(0.0, material_id, model_id);
+    if (id_code != ERROR_NONE && policy == ErrorPolicy::Raise) {
+      throw nb::value_error(id_error_message(id_code, material_id, model_id, 0).c_str());
+    }
+    double result = INVALID_RESULT;
+    if (code == ERROR_NONE) {
+      auto table = mode == "table" ? fetch_range_table(material_id, model_id) : nullptr;
+      StatsComputePhase phase(1);
+      size_t hint = 0;
+      result = table ? table->lookup(energy, hint) : AT_max_electron_range_m(energy, material_id, model_id);
     }
-    double energy = variant_cast<double>(vec[0]);
-    int mat_id = variant_cast<int>(vec[1]);
-    int model_id = variant_cast<int>(vec[2]);
+    if (policy == ErrorPolicy::Mask) return nb::make_tuple(result, code);
+    return nb::cast(result);
+  }
 
-    return AT_max_electron_range_m(energy, mat_id, model_id);
-  };
-  if (cartesian_product) return wrap_cartesian_product_function(electron_range_vector, arguments_vector);
-  return wrap_multiargument_function(electron_range_vector, arguments_vector);
+  std::vector<Column> columns;
+  for (const auto& argument : arguments_vector) columns.push_back(make_column(argument));
+  const BroadcastLayout layout = cartesian_product ? cartesian_layout(columns) : broadcast_columns(columns);
+
+  const bool valid_ids = ids_valid(columns);
+  const nb::object codes = check_elements(columns, layout, where, policy, valid_ids);
+
+  nb::object result;
+  if (mode == "table") {
+    result = electron_range_table(columns, layout, cartesian_product, valid_ids, out, where, dtype, out_file);
+  } else if (cartesian_product) {
+    result = electron_range_cartesian_product(columns, layout, out, where, dtype, out_file);
+  } else {
+    result = evaluate_vectorized<&checked_max_electron_range_m, double, int, int>(columns, layout, out, where, dtype);
+  }
+  if (policy == ErrorPolicy::Mask) return nb::make_tuple(result, codes);
+  return result;
 }
+
+/**
+ * State of the elements of one (material, model) pair in energy_from_electron_range: the table of the pair
+ * with mode="table", and the warm starts of its lookups (the interval and the solver hint).
+ */
+struct EnergyLookupState {
+  bool valid = false;  // Whether the material and model IDs are known
+  const RangeTable* table = nullptr;
+  size_t interval = 0;
+  EnergySolverHint hint;
+};
+
+/**
+ * Evaluates energy_from_electron_range over the layout of its (range, material, model) columns, on the shared
+ * thread pool and without the GIL. Every chunk of the output keeps one EnergyLookupState per pair, so each
+ * solution warm-starts the next of its pair, also across the interleaved pairs of a cartesian product.
+ * `tables` holds the tables of the pairs with mode="table" and is empty with mode="exact". Elements of unknown
+ * ids and negative or NaN ranges get INVALID_RESULT.
+ */
+nb::object energy_from_range_values(const std::vector<Column>& columns, const BroadcastLayout& layout,
+                                    bool cartesian_product,
+                                    const std::vector<std::shared_ptr<const RangeTable>>& tables,
+                                    const nb::object& out, const nb::object& where, const nb::object& dtype,
+                                    const nb::object& out_file) {
+  return dispatch_output_dtype(dtype, out, [&](auto output_type) {
+    using Out = typename decltype(output_type)::type;
+    if (cartesian_product && layout.size == 0) {
+      OutputBuffer<Out> empty(out, {0}, out_file);
+      return empty.result();
+    }
+
+    OutputBuffer<Out> output(out, layout.shape, out_file);
+    WhereMask mask = make_where_mask(where, layout.shape);
+
+    try {
+      StatsComputePhase phase(layout.size);
+      nb::gil_scoped_release release;
+      Out* results = output.data();
+      const bool fill_masked = !output.is_user_provided();
+      auto fill = [&](size_t begin, size_t end) {
+        std::unordered_map<int64_t, EnergyLookupState> states;
+        EnergyLookupState* state = nullptr;
+        int64_t state_pair = 0;
+        WhereCursor selected(mask, begin);
+        for_each_broadcast(layout, begin, end, [&](size_t i, const std::vector<int64_t>& offsets) {
+          if (!selected.next()) {
+            if (fill_masked) results[i] = static_cast<Out>(MASKED_VALUE);
+            return;
+          }
+          int material = column_value<int>(columns[1], offsets[1]);
+          int model = column_value<int>(columns[2], offsets[2]);
+          int64_t pair = (static_cast<int64_t>(material) << 32) | static_cast<uint32_t>(model);
+          if (!state || pair != state_pair) {
+            auto [it, inserted] = states.try_emplace(pair);
+            state = &it->second;
+            state_pair = pair;
+            if (inserted) {
+              state->valid = is_material_id(material) && is_model_id(model);
+              for (const auto& table : tables) {
+                if (table->material() == material && table->model() == model) state->table = table.get();
+              }
+            }
+          }
+          double range = column_value<double>(columns[0], offsets[0]);
+          if (!state->valid || !(range >= 0)) {
+            results[i] = static_cast<Out>(INVALID_RESULT);
+            return;
+          }
+          double energy = state->table ? state->table->energy_lookup(range, state->interval, state->hint)
+                                       : solve_energy_from_range(range, material, model, state->hint);
+          results[i] = static_cast<Out>(energy);
+        });
+      };
+      output.fill_in_order(layout.size, 1, [&](size_t first, size_t last) {
+        parallel_for(last - first, [&](size_t begin, size_t end) { fill(first + begin, first + end); });
+      });
+    } catch (const std::exception& e) {
+      throw std::runtime_error("Error processing NumPy array: " + std::string(e.what()));
+    }
+
+    return output.result();
+  });
+}
+
+nb::object energy_from_electron_range(const nb::object& range_m, const nb::object& material,
+                                      const nb::object& model, const bool cartesian_product, const nb::object& out,
+                                      const nb::object& where, const nb::object& dtype, const std::string& mode,
+                                      const nb::object& out_file, const std::string& errors) {
+  StatsCall call("stopping.energy_from_electron_range");
+  if (mode != "exact" && mode != "table") {
+    throw nb::value_error(("mode must be \"exact\" or \"table\", got \"" + mode + "\".").c_str());
+  }
+  if (!out_file.is_none() && !cartesian_product) {
+    throw nb::value_error("out_file is only supported together with cartesian_product=True.");
+  }
+  const ErrorPolicy policy = parse_error_policy(errors);
+  std::vector<nb::object> arguments_vector;
+  arguments_vector.push_back(range_m);
+  arguments_vector.push_back(get_id(material, process_material));
+  arguments_vector.push_back(get_id(model, process_model));
+
+  // Scalar arguments give a Python float
+  bool scalars_only = !cartesian_product && out.is_none() && where.is_none() && dtype.is_none();
+  for (const auto& argument : arguments_vector) {
+    scalars_only = scalars_only && (PyFloat_Check(argument.ptr()) || PyLong_Check(argument.ptr()));
+  }
+  if (scalars_only) {
+    const double range = nb::cast<double>(arguments_vector[0]);
+    const int material_id = nb::cast<int>(arguments_vector[1]);
+    const int model_id = nb::cast<int>(arguments_vector[2]);
+    const uint8_t code = electron_range_error(range, material_id, model_id);
+    // With errors="raise" only the ids are checked, a negative or NaN range gives NaN
+    const uint8_t id_code = electron_range_error(0.0, material_id, model_id);
+    if (id_code != ERROR_NONE && policy == ErrorPolicy::Raise) {
+      throw nb::value_error(id_error_message(id_code, material_id, model_id, 0).c_str());
+    }
+    double result = INVALID_RESULT;
+    if (code == ERROR_NONE) {
+      auto table = mode == "table" ? fetch_range_table(material_id, model_id) : nullptr;
+      StatsComputePhase phase(1);
+      size_t interval = 0;
+      EnergySolverHint hint;
+      result = table ? table->energy_lookup(range, interval, hint)
+                     : solve_energy_from_range(range, material_id, model_id, hint);
+    }
+    if (policy == ErrorPolicy::Mask) return nb::make_tuple(result, code);
+    return nb::cast(result);
+  }
+
+  std::vector<Column> columns;
+  for (const auto& argument : arguments_vector) columns.push_back(make_column(argument));
+  const BroadcastLayout layout = cartesian_product ? cartesian_layout(columns) : broadcast_columns(columns);
+
+  const nb::object codes = check_elements(columns, layout, where, policy, ids_valid(columns));
+
+  std::vector<std::shared_ptr<const RangeTable>> tables;
+  if (mode == "table") tables = fetch_range_tables(columns, layout, cartesian_product);
+  nb::object result = energy_from_range_values(columns, layout, cartesian_product, tables, out, where, dtype, out_file);
+  if (policy == ErrorPolicy::Mask) return nb::make_tuple(result, codes);
+  return result;
+}
+
+namespace {
+
+// Number of elements of a scalar, list or array argument
+size_t argument_size(const nb::object& argument) {
+  if (nb::isinstance<nb::list>(argument)) return nb::len(argument);
+  if (nb::isinstance<nb::ndarray<>>(argument)) return nb::cast<nb::ndarray<>>(argument).size();
+  return 1;
+}
+
+// A chunk of energies as a 1-D sequence which can be sliced without copying its elements
+nb::object flatten_chunk(const nb::object& chunk) {
+  if (nb::isinstance<nb::list>(chunk)) return chunk;
+  if (nb::isinstance<nb::ndarray<>>(chunk)) return chunk.attr("reshape")(-1);
+  if (PyFloat_Check(chunk.ptr()) || PyLong_Check(chunk.ptr())) {
+    nb::list single;
+    single.append(chunk);
+    return single;
+  }
+  throw nb::type_error("Energy chunks must be floats, ints, lists or NumPy arrays.");
+}
+
+}  // namespace
+
+ElectronRangeIterator::ElectronRangeIterator(const nb::object& energy_MeV, const nb::object& material,
+                                             const nb::object& model, size_t chunk_elements, const nb::object& dtype,
+                                             const std::string& mode)
+    : dtype_(dtype), mode_(mode) {
+  if (chunk_elements == 0) throw nb::value_error("chunk_elements must be positive.");
+  if (mode != "exact" && mode != "table") {
+    throw nb::value_error(("mode must be \"exact\" or \"table\", got \"" + mode + "\".").c_str());
+  }
+  // Materials and models are resolved once, not for every block
+  materials_ = get_id(material, process_material);
+  models_ = get_id(model, process_model);
+
+  // Whole inputs are a single chunk; anything else iterable yields the chunks
+  const bool single_input = nb::isinstance<nb::list>(energy_MeV) || nb::isinstance<nb::ndarray<>>(energy_MeV) ||
+                            PyFloat_Check(energy_MeV.ptr()) || PyLong_Check(energy_MeV.ptr());
+  if (single_input) {
+    nb::list chunks;
+    chunks.append(energy_MeV);
+    source_ = nb::iter(chunks);
+  } else {
+    try {
+      source_ = nb::iter(energy_MeV);
+    } catch (const nb::python_error&) {
+      throw nb::type_error("energy_MeV must be a float, int, list, NumPy array or an iterable of them.");
+    }
+  }
+
+  const size_t results_per_energy = argument_size(materials_) * argument_size(models_);
+  energies_per_block_ = std::max<size_t>(1, results_per_energy ? chunk_elements / results_per_energy : chunk_elements);
+}
+
+nb::tuple ElectronRangeIterator::next() {
+  // Take the next non-empty chunk of energies from the source
+  while (chunk_offset_ >= chunk_size_) {
+    PyObject* item = PyIter_Next(source_.ptr());
+    if (!item) {
+      if (PyErr_Occurred()) throw nb::python_error();
+      throw nb::stop_iteration();
+    }
+    chunk_ = flatten_chunk(nb::steal(item));
+    chunk_size_ = nb::len(chunk_);
+    chunk_offset_ = 0;
+  }
+
+  const size_t count = std::min(energies_per_block_, chunk_size_ - chunk_offset_);
+  nb::object energies = chunk_[nb::slice(nb::int_(chunk_offset_), nb::int_(chunk_offset_ + count), nb::none())];
+  chunk_offset_ += count;
+  nb::slice index(nb::int_(position_), nb::int_(position_ + count), nb::none());
+  position_ += count;
+
+  // The state is updated before electron_range releases the GIL (or the lock of the iterator on
+  // free-threaded Python), so a concurrent call takes the following block
+  nb::object block = electron_range(energies, materials_, models_, true, nb::none(), nb::none(), dtype_, mode_);
+  return nb::make_tuple(index, block);
+}
+
+nb::dict table_info(const RangeTable& table) {
+  nb::dict info;
+  info["material"] = table.material();
+  info["model"] = table.model();
+  info["rtol"] = table.options().rtol;
+  info["energy_min_MeV"] = table.options().energy_min_MeV;
+  info["energy_max_MeV"] = table.options().energy_max_MeV;
+  info["intervals"] = table.num_intervals();
+  info["exact_intervals"] = table.num_exact_intervals();
+  info["max_rel_error"] = table.max_rel_error();
+  info["memory_bytes"] = table.memory_bytes();
+  return info;
+}
+
+nb::dict build_table(const nb::object& material, const nb::object& model, double rtol, double energy_min_MeV,
+                     double energy_max_MeV) {
+  int material_id = process_material(material);
+  int model_id = process_model(model);
+  RangeTableOptions options;
+  options.rtol = rtol;
+  options.energy_min_MeV = energy_min_MeV;
+  options.energy_max_MeV = energy_max_MeV;
+
+  std::shared_ptr<const RangeTable> table;
+  {
+    nb::gil_scoped_release release;
+    table = build_range_table(material_id, model_id, options);
+  }
+  return table_info(*table);
+}
+
+nb::list table_cache_info() {
+  nb::list result;
+  for (const auto& table : cached_range_tables()) result.append(table_info(*table));
+  return result;
+}
+
+void clear_table_cache() { clear_range_table_cache(); }
@@ -6,6 +6,7 @@
 #include <nanobind/stl/string.h>
 #include <nanobind/stl/vector.h>
 
+#include <cstdint>
 #include <map>
 
 #include "../materials/materials.h"
@@ -45,6 +46,31 @@ std::vector<std::string> get_models();
  */
 int get_model_id(const std::string& model_name);
 
+/**
+ * @brief Whether a model ID is one of the electron range models of libamtrack.
+ *
+ * Besides the models of STOPPING_MODELS, this accepts the test model of libamtrack (ID=1).
+ */
+inline bool is_model_id(int64_t model_id) {
+  if (model_id == 1) return true;
+  for (const auto& [name, id] : STOPPING_MODELS) {
+    if (id == model_id) return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Error codes of the elements of electron_range(..., errors="mask"), ERROR_NONE (0) for valid elements.
+ */
+constexpr uint8_t ERROR_INVALID_ENERGY = 1;   /**< Negative or NaN energy. */
+constexpr uint8_t ERROR_INVALID_MATERIAL = 2; /**< Material ID not in the material table. */
+constexpr uint8_t ERROR_INVALID_MODEL = 3;    /**< Unknown model ID. */
+
+/**
+ * @brief Error code of a negative or NaN range in energy_from_electron_range, which shares the other codes.
+ */
+constexpr uint8_t ERROR_INVALID_RANGE = ERROR_INVALID_ENERGY;
+
 /**
  * @brief Calculate the maximum electron range in a material.
  *
@@ -58,13 +84,145 @@ int get_model_id(const std::string& model_name);
  *             Defaults to "tabata" (ID=7).
  * @param cartesian_product Parameter that tells whether to compute the cartesian product (all possible combinations) of
  * the preceding parameters
+ * @param out Optional writable C-contiguous float64 array of the result shape to store the results in.
+ * @param where Optional boolean mask broadcastable to the result shape; ranges are only computed where it is true.
+ * @param dtype Optional dtype of the result, numpy.float64 (default) or numpy.float32.
+ * @param mode "exact" to call AT_max_electron_range_m for every element, or "table" to interpolate
+ *             cached tables (see RangeTable), built on first use of every (material, model) pair.
+ * @param out_file Optional path of a .npy file to write a cartesian product into, instead of memory.
+ * @param errors Handling of elements with an unknown material or model ID, or a negative or NaN energy (see
+ *               ErrorPolicy): "raise" (default) raises before computing for an unknown ID, while a negative
+ *               or NaN energy gives NaN; "nan" stores NaN as the range of every invalid element, and "mask"
+ *               also returns the uint8 error code of every element (ERROR_INVALID_*).
  * @return nb::object The calculated electron range(s) in meters. Returns a float for single input,
- *                   NumPy array for array input, or Python list for list input.
+ *                   NumPy array for array input, or Python list for list input. Returns `out` if it was given,
+ *                   or the file opened with numpy.load(out_file, mmap_mode="r"). With errors="mask", a tuple
+ *                   of the ranges and the error codes (an int for a float range).
  * @throws nb::type_error If material argument is neither an integer nor a Material object,
  *                      or if model argument is neither a string nor an integer.
+ * @throws nb::value_error If a material or model ID is unknown with errors="raise", or `errors` is not a valid
+ *                         policy.
  * @throws std::runtime_error If the model name/ID is invalid.
  */
 nb::object electron_range(const nb::object& energy_MeV, const nb::object& material = nb::int_(1),
-                          const nb::object& model = nb::str("tabata"), bool cartesian_product = false);
+                          const nb::object& model = nb::str("tabata"), bool cartesian_product = false,
+                          const nb::object& out = nb::none(), const nb::object& where = nb::none(),
+                          const nb::object& dtype = nb::none(), const std::string& mode = "exact",
+                          const nb::object& out_file = nb::none(), const std::string& errors = "raise");
+
+/**
+ * @brief Calculate the electron energy whose maximum electron range in a material is the given range.
+ *
+ * The inverse of electron_range, with the same argument forms: ranges, materials and models are broadcast
+ * (or combined in a cartesian product) in the same way. Every energy is solved natively with
+ * solve_energy_from_range, warm-started from the previous solution of the same (material, model) pair,
+ * so sorted ranges need fewest evaluations of the model.
+ *
+ * @param range_m The electron range in meters. Can be a single value, NumPy array, or Python list.
+ * @param material Either a material ID (int) or a Material object. Defaults to 1 (Liquid water).
+ * @param model The model, as a string name or model ID. Defaults to "tabata" (ID=7).
+ * @param cartesian_product Whether to compute the cartesian product of the preceding parameters.
+ * @param out Optional writable C-contiguous array of the result shape to store the results in.
+ * @param where Optional boolean mask broadcastable to the result shape; energies are only computed where it is true.
+ * @param dtype Optional dtype of the result, numpy.float64 (default) or numpy.float32.
+ * @param mode "exact" to solve with AT_max_electron_range_m, or "table" to invert the cached table of every
+ *             (material, model) pair (see RangeTable::energy_lookup), built on first use.
+ * @param out_file Optional path of a .npy file to write a cartesian product into, instead of memory.
+ * @param errors Handling of elements with a negative or NaN range, or an unknown material or model ID, as in
+ *               electron_range (ERROR_INVALID_RANGE, ERROR_INVALID_MATERIAL, ERROR_INVALID_MODEL).
+ * @return nb::object The energies in MeV, as electron_range returns ranges: a float for scalar inputs,
+ *                    otherwise an array. Ranges beyond those of the energies from SOLVER_ENERGY_MIN_MeV to
+ *                    SOLVER_ENERGY_MAX_MeV give NaN.
+ * @throws nb::type_error If material or model arguments are of unsupported types.
+ * @throws nb::value_error If a material or model ID is unknown with errors="raise", or mode or errors are invalid.
+ */
+nb::object energy_from_electron_range(const nb::object& range_m, const nb::object& material = nb::int_(1),
+                                      const nb::object& model = nb::str("tabata"), bool cartesian_product = false,
+                                      const nb::object& out = nb::none(), const nb::object& where = nb::none(),
+                                      const nb::object& dtype = nb::none(), const std::string& mode = "exact",
+                                      const nb::object& out_file = nb::none(), const std::string& errors = "raise");
+
+/**
+ * @brief Default number of results per block yielded by ElectronRangeIterator (8 MB of float64).
+ */
+constexpr size_t DEFAULT_CHUNK_ELEMENTS = size_t(1) << 20;
+
+/**
+ * @brief Iterator evaluating the cartesian product of energies, materials and models block by block.
+ *
+ * The full result, of shape (number of energies, *material shape, *model shape), is never allocated:
+ * each step evaluates the ranges of the next energies with electron_range(..., cartesian_product=True)
+ * and returns a (slice, block) tuple, where the slice selects the energies of the block along the first
+ * axis of the full result. Blocks hold at most `chunk_elements` results, or a single energy when one
+ * energy alone gives more results. Only the block being returned is held, so memory stays bounded
+ * by the block size whatever the number of energies.
+ *
+ * Energies are taken from an array (any number of dimensions, flattened in C order), a list, a scalar,
+ * or from any other iterable (e.g. a generator) yielding chunks of energies (scalars, lists or arrays),
+ * which are read lazily, one at a time. Chunks larger than the block size are split.
+ */
+class ElectronRangeIterator {
+ public:
+  /**
+   * @param energy_MeV Energies, or an iterable of chunks of energies.
+   * @param material Material ID, Material object or list/array of them.
+   * @param model Model name, ID or list/array of them.
+   * @param chunk_elements Largest number of results per block.
+   * @param dtype Dtype of the blocks, numpy.float64 (default) or numpy.float32.
+   * @param mode "exact" or "table", see electron_range.
+   * @throws nb::value_error If chunk_elements is 0 or mode is invalid.
+   * @throws nb::type_error If material, model or energy_MeV are of unsupported types.
+   */
+  ElectronRangeIterator(const nb::object& energy_MeV, const nb::object& material, const nb::object& model,
+                        size_t chunk_elements, const nb::object& dtype, const std::string& mode);
+
+  /**
+   * @brief Returns the next (slice, block) tuple.
+   * @throws nb::stop_iteration When all energies have been evaluated.
+   */
+  nb::tuple next();
+
+ private:
+  nb::object source_;  // iterator over chunks of energies
+  nb::object chunk_;   // current chunk, a 1-D array or list
+  size_t chunk_size_ = 0;
+  size_t chunk_offset_ = 0;
+  nb::object materials_;  // material IDs
+  nb::object models_;     // model IDs
+  nb::object dtype_;
+  std::string mode_;
+  size_t energies_per_block_;
+  size_t position_ = 0;  // index of the next energy in the full result
+};
+
+/**
+ * @brief Build the interpolation table of a (material, model) pair used by electron_range with mode="table".
+ *
+ * The table replaces any cached table of the same pair.
+ *
+ * @param material Material ID (int) or Material object.
+ * @param model Model name or ID.
+ * @param rtol Relative error bound of the interpolated ranges, checked at 16 points per interval.
+ * @param energy_min_MeV Lowest tabulated energy.
+ * @param energy_max_MeV Highest tabulated energy.
+ * @return nb::dict Description of the table, see table_cache_info.
+ * @throws std::invalid_argument If rtol or the energy range are invalid.
+ */
+nb::dict build_table(const nb::object& material, const nb::object& model, double rtol, double energy_min_MeV,
+                     double energy_max_MeV);
+
+/**
+ * @brief Describe the cached interpolation tables.
+ *
+ * @return nb::list One dict per table with its material, model, rtol, energy range, number of intervals,
+ *                  number of exactly evaluated intervals, largest relative error at the sampled points and
+ *                  memory use.
+ */
+nb::list table_cache_info();
+
+/**
+ * @brief Remove all cached interpolation tables.
+ */
+void clear_table_cache();
 
 #endif  // ELECTRON_RANGE_H
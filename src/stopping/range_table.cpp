@@ -0,0 +1,315 @@
+#include "range_table.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+#include "../runtime/thread_pool.h"
+
+extern "C" {
+#include "AT_ElectronRange.h"
+}
+
+namespace {
+
+// Intervals handled by one task while building a table
+constexpr size_t BUILD_CHUNK = 64;
+
+// Failing intervals are accepted (and evaluated exactly) once they are at most 1 / MAX_FAILING_FRACTION of the table
+constexpr size_t MAX_FAILING_FRACTION = 1024;
+
+// Relative step of the central differences giving the derivatives at the nodes
+constexpr double DERIVATIVE_STEP = 1e-6;
+
+// Largest change of log(energy) per Newton step of solve_energy_from_range while bracketing the solution
+constexpr double SOLVER_MAX_STEP = 4.0;
+
+// Accuracy of solve_energy_from_range: change of log(energy), and residual in log(range), below which it stops
+constexpr double SOLVER_TOLERANCE = 1e-12;
+constexpr double SOLVER_RESIDUAL_TOLERANCE = 1e-14;
+constexpr int SOLVER_MAX_ITERATIONS = 100;
+
+// Newton iterations solving the cubic of an interval in RangeTable::energy_lookup
+constexpr double CUBIC_TOLERANCE = 1e-14;
+constexpr int CUBIC_MAX_ITERATIONS = 50;
+
+bool is_usable(double value) { return std::isfinite(value) && value > 0.0; }
+
+std::mutex cache_mutex;
+std::map<std::pair<int, int>, std::shared_ptr<const RangeTable>> cache;
+
+}  // namespace
+
+double solve_energy_from_range(double range_m, int material, int model, EnergySolverHint& hint,
+                               double energy_min_MeV, double energy_max_MeV) {
+  constexpr double nan = std::numeric_limits<double>::quiet_NaN();
+  if (range_m == 0.0) return 0.0;
+  if (!is_usable(range_m)) return nan;
+
+  const double target = std::log(range_m);
+  const double x_min = std::log(energy_min_MeV);
+  const double x_max = std::log(energy_max_MeV);
+  // Residual in log(range) at x = log(energy); ranges which are not positive are below any target
+  auto residual = [&](double x) {
+    double range = AT_max_electron_range_m(std::exp(x), material, model);
+    return range > 0.0 ? std::log(range) - target : -std::numeric_limits<double>::infinity();
+  };
+
+  // Warm start: Newton step from the previous solution
+  double slope = hint.valid && is_usable(hint.slope) ? hint.slope : EnergySolverHint().slope;
+  double x = hint.valid ? hint.log_energy + (target - hint.log_range) / slope : 0.0;
+  x = std::min(std::max(x, x_min), x_max);
+  double f = residual(x);
+
+  // Updates the slope with the secant of two consecutive points, while it stays positive
+  auto update_slope = [&](double x0, double f0, double x1, double f1) {
+    double secant = (f1 - f0) / (x1 - x0);
+    if (is_usable(secant)) slope = secant;
+  };
+
+  // Newton steps until the solution is bracketed by [lo, hi] with f(lo) < 0 < f(hi), or reached
+  double lo = x_min, hi = x_max, f_lo = 0.0, f_hi = 0.0;
+  bool has_lo = false, has_hi = false, converged = false;
+  for (int iteration = 0; iteration < SOLVER_MAX_ITERATIONS; ++iteration) {
+    if (std::abs(f) <= SOLVER_RESIDUAL_TOLERANCE) {
+      converged = true;
+      break;
+    }
+    if (f < 0.0) {
+      lo = x;
+      f_lo = f;
+      has_lo = true;
+    } else {
+      hi = x;
+      f_hi = f;
+      has_hi = true;
+    }
+    if (has_lo && has_hi) break;
+    // The range is beyond those of the searched energies
+    if ((f < 0.0 && x >= x_max) || (f > 0.0 && x <= x_min)) return nan;
+
+    double step = std::isfinite(f) ? -f / slope : SOLVER_MAX_STEP;
+    step = std::min(std::max(step, -SOLVER_MAX_STEP), SOLVER_MAX_STEP);
+    double next = std::min(std::max(x + step, x_min), x_max);
+    double f_next = residual(next);
+    update_slope(x, f, next, f_next);
+    converged = std::abs(next - x) <= SOLVER_TOLERANCE;
+    x = next;
+    f = f_next;
+    if (converged) break;
+  }
+
+  // Regula falsi within the bracket, halving the residual of an end kept twice (Illinois), or bisection
+  // when an end is below the validity of the model
+  int kept = 0;
+  for (int iteration = 0; !converged && has_lo && has_hi && iteration < SOLVER_MAX_ITERATIONS; ++iteration) {
+    double next = std::isfinite(f_lo) ? lo - f_lo * (hi - lo) / (f_hi - f_lo) : 0.5 * (lo + hi);
+    if (!(next > lo && next < hi)) next = 0.5 * (lo + hi);
+    double f_next = residual(next);
+    update_slope(x, f, next, f_next);
+    converged = std::abs(next - x) <= SOLVER_TOLERANCE || std::abs(f_next) <= SOLVER_RESIDUAL_TOLERANCE;
+    x = next;
+    f = f_next;
+    if (f < 0.0) {
+      lo = x;
+      f_lo = f;
+      if (kept == 1) f_hi *= 0.5;
+      kept = 1;
+    } else {
+      hi = x;
+      f_hi = f;
+      if (kept == -1) f_lo *= 0.5;
+      kept = -1;
+    }
+    converged = converged || hi - lo <= SOLVER_TOLERANCE;
+  }
+
+  hint.log_range = target;
+  hint.log_energy = x;
+  hint.slope = slope;
+  hint.valid = true;
+  return std::exp(x);
+}
+
+RangeTable::RangeTable(int material, int model, const RangeTableOptions& options)
+    : material_(material), model_(model), options_(options) {
+  if (!(options.rtol > 0.0)) throw std::invalid_argument("rtol must be positive.");
+  if (!(options.energy_min_MeV > 0.0 && options.energy_max_MeV > options.energy_min_MeV)) {
+    throw std::invalid_argument("The energy range of the table must satisfy 0 < energy_min_MeV < energy_max_MeV.");
+  }
+  energy_min_ = options.energy_min_MeV;
+  energy_max_ = options.energy_max_MeV;
+  log_energy_min_ = std::log(energy_min_);
+  const double log_span = std::log(energy_max_) - log_energy_min_;
+
+  for (size_t n = 256;; n *= 2) {
+    const bool last_attempt = n >= MAX_INTERVALS;
+    inv_log_step_ = static_cast<double>(n) / log_span;
+
+    // Values and derivatives at the nodes
+    nodes_.resize(n + 1);
+    std::vector<double> values(n + 1), derivatives(n + 1);
+    parallel_for(
+        n + 1,
+        [&](size_t begin, size_t end) {
+          for (size_t k = begin; k < end; ++k) {
+            double energy = k == n ? energy_max_ : std::exp(log_energy_min_ + log_span * k / n);
+            nodes_[k] = energy;
+            values[k] = AT_max_electron_range_m(energy, material_, model_);
+            double h = energy * DERIVATIVE_STEP;
+            derivatives[k] = (AT_max_electron_range_m(energy + h, material_, model_) -
+                              AT_max_electron_range_m(energy - h, material_, model_)) /
+                             (2.0 * h);
+          }
+        },
+        BUILD_CHUNK);
+
+    // Hermite polynomials and their verification against the exact function
+    intervals_.resize(n);
+    std::vector<double> errors(n);
+    parallel_for(
+        n,
+        [&](size_t begin, size_t end) {
+          for (size_t k = begin; k < end; ++k) {
+            Interval& c = intervals_[k];
+            double width = nodes_[k + 1] - nodes_[k];
+            double y0 = values[k], y1 = values[k + 1];
+            double d0 = derivatives[k] * width, d1 = derivatives[k + 1] * width;
+            c.c0 = y0;
+            c.c1 = d0;
+            c.c2 = 3.0 * (y1 - y0) - 2.0 * d0 - d1;
+            c.c3 = 2.0 * (y0 - y1) + d0 + d1;
+            c.inv_width = 1.0 / width;
+            c.exact = !(is_usable(y0) && is_usable(y1) && std::isfinite(d0) && std::isfinite(d1));
+
+            double error = 0.0;
+            for (int p = 1; p <= VERIFY_POINTS && !c.exact; ++p) {
+              double u = static_cast<double>(p) / (VERIFY_POINTS + 1);
+              double expected = AT_max_electron_range_m(nodes_[k] + u * width, material_, model_);
+              if (!is_usable(expected)) {
+                c.exact = true;
+                break;
+              }
+              double interpolated = ((c.c3 * u + c.c2) * u + c.c1) * u + c.c0;
+              error = std::max(error, std::abs(interpolated - expected) / expected);
+            }
+            errors[k] = c.exact ? 0.0 : error;
+          }
+        },
+        BUILD_CHUNK);
+
+    // Refining does not help across kinks of piecewise models, so a few failing intervals are accepted
+    // once they cover a negligible part of the table
+    size_t failing = 0;
+    for (size_t k = 0; k < n; ++k) failing += errors[k] > options.rtol;
+    if (failing == 0 || failing * MAX_FAILING_FRACTION <= n || last_attempt) {
+      // Intervals still above the bound fall back to the exact function
+      increasing_ = is_usable(values[0]);
+      for (size_t k = 0; k < n; ++k) increasing_ = increasing_ && is_usable(values[k + 1]) && values[k + 1] > values[k];
+      ranges_ = std::move(values);
+      num_exact_ = 0;
+      max_rel_error_ = 0.0;
+      for (size_t k = 0; k < n; ++k) {
+        if (errors[k] > options.rtol) intervals_[k].exact = true;
+        if (intervals_[k].exact) {
+          ++num_exact_;
+        } else {
+          max_rel_error_ = std::max(max_rel_error_, errors[k]);
+        }
+      }
+      break;
+    }
+  }
+}
+
+double RangeTable::exact(double energy_MeV) const { return AT_max_electron_range_m(energy_MeV, material_, model_); }
+
+size_t RangeTable::locate(double energy_MeV) const {
+  double position = (std::log(energy_MeV) - log_energy_min_) * inv_log_step_;
+  size_t last = intervals_.size() - 1;
+  size_t i = position <= 0.0 ? 0 : std::min(static_cast<size_t>(position), last);
+  // The logarithm may be off by one ulp at the nodes
+  if (i > 0 && energy_MeV < nodes_[i]) --i;
+  if (i < last && energy_MeV >= nodes_[i + 1]) ++i;
+  return i;
+}
+
+double RangeTable::energy_lookup(double range_m, size_t& hint, EnergySolverHint& solver) const {
+  if (!increasing_ || !(range_m >= ranges_.front() && range_m <= ranges_.back())) {
+    return solve_energy_from_range(range_m, material_, model_, solver);
+  }
+
+  size_t i = hint;
+  if (range_m < ranges_[i] || range_m >= ranges_[i + 1]) {
+    // Sorted inputs usually land in the next interval or the one after
+    if (range_m >= ranges_[i + 1] && i + 2 < ranges_.size() && range_m < ranges_[i + 2]) {
+      i += 1;
+    } else {
+      size_t above = std::upper_bound(ranges_.begin(), ranges_.end(), range_m) - ranges_.begin();
+      i = std::min(above == 0 ? 0 : above - 1, intervals_.size() - 1);
+    }
+    hint = i;
+  }
+
+  const Interval& c = intervals_[i];
+  if (c.exact) return solve_energy_from_range(range_m, material_, model_, solver, nodes_[i], nodes_[i + 1]);
+
+  // The cubic goes from ranges_[i] at u = 0 to ranges_[i + 1] at u = 1; Newton from the linear interpolation
+  double lo = 0.0, hi = 1.0;
+  double u = (range_m - ranges_[i]) / (ranges_[i + 1] - ranges_[i]);
+  for (int iteration = 0; iteration < CUBIC_MAX_ITERATIONS; ++iteration) {
+    double residual = ((c.c3 * u + c.c2) * u + c.c1) * u + c.c0 - range_m;
+    if (residual == 0.0) break;
+    if (residual < 0.0) {
+      lo = u;
+    } else {
+      hi = u;
+    }
+    double next = u - residual / ((3.0 * c.c3 * u + 2.0 * c.c2) * u + c.c1);
+    if (!(next > lo && next < hi)) next = 0.5 * (lo + hi);
+    bool converged = std::abs(next - u) <= CUBIC_TOLERANCE;
+    u = next;
+    if (converged) break;
+  }
+  return nodes_[i] + u / c.inv_width;
+}
+
+size_t RangeTable::memory_bytes() const {
+  return sizeof(RangeTable) + (nodes_.capacity() + ranges_.capacity()) * sizeof(double) +
+         intervals_.capacity() * sizeof(Interval);
+}
+
+std::shared_ptr<const RangeTable> get_range_table(int material, int model) {
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto it = cache.find({material, model});
+    if (it != cache.end()) return it->second;
+  }
+  auto table = std::make_shared<const RangeTable>(material, model, RangeTableOptions());
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  // Another thread may have built the same table in the meantime, keep the first one
+  return cache.emplace(std::make_pair(material, model), table).first->second;
+}
+
+std::shared_ptr<const RangeTable> build_range_table(int material, int model, const RangeTableOptions& options) {
+  auto table = std::make_shared<const RangeTable>(material, model, options);
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  cache[{material, model}] = table;
+  return table;
+}
+
+std::vector<std::shared_ptr<const RangeTable>> cached_range_tables() {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  std::vector<std::shared_ptr<const RangeTable>> tables;
+  for (const auto& entry : cache) tables.push_back(entry.second);
+  return tables;
+}
+
+void clear_range_table_cache() {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  cache.clear();
+}
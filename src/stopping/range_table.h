@@ -0,0 +1,206 @@
+#ifndef RANGE_TABLE_H
+#define RANGE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Parameters of an electron range interpolation table.
+ */
+struct RangeTableOptions {
+  double rtol = 1e-6;            /**< Relative error bound of the interpolated ranges, checked on samples. */
+  double energy_min_MeV = 1e-3;  /**< Lowest tabulated energy; smaller energies are computed exactly. */
+  double energy_max_MeV = 1e4;   /**< Highest tabulated energy; larger energies are computed exactly. */
+};
+
+/** Lowest energy returned by solve_energy_from_range; smaller ranges have no solution. */
+constexpr double SOLVER_ENERGY_MIN_MeV = 1e-6;
+/** Highest energy returned by solve_energy_from_range; larger ranges have no solution. */
+constexpr double SOLVER_ENERGY_MAX_MeV = 1e6;
+
+/**
+ * @brief State carried between consecutive calls of solve_energy_from_range, to warm-start them.
+ *
+ * Holds the last solution and the local slope d log(range) / d log(energy) of the model there. The next
+ * call starts from the Newton step of that solution towards its own range, so the solutions of sorted or
+ * clustered ranges are usually bracketed by the first evaluations. Start with a default-constructed hint
+ * and keep one per sequence of calls with the same material and model (e.g. per thread).
+ */
+struct EnergySolverHint {
+  double log_range = 0.0;   /**< log of the range of the last solution, in m. */
+  double log_energy = 0.0;  /**< log of the last solution, in MeV. */
+  double slope = 1.7;       /**< d log(range) / d log(energy) at the last solution (about 1.7 for electrons). */
+  bool valid = false;       /**< Whether the fields hold a previous solution. */
+};
+
+/**
+ * @brief Returns the electron energy in MeV whose AT_max_electron_range_m is the given range.
+ *
+ * The model is taken as increasing with the energy. The equation log(range(E)) = log(range_m) is solved in
+ * log E, where it is nearly linear: from the warm start of `hint`, Newton steps using secant slopes expand
+ * a bracket of the solution, which is then narrowed by regula falsi (Illinois variant, falling back to
+ * bisection where the model is not positive), to a relative accuracy of about 1e-12 in energy. A few
+ * evaluations of the model are needed per solution, less with a close warm start.
+ *
+ * @param range_m Range in meters, non-negative.
+ * @param material Material ID.
+ * @param model Electron range model ID.
+ * @param hint Warm start, updated to this solution.
+ * @param energy_min_MeV, energy_max_MeV Energies searched; the solution is assumed to lie between them.
+ * @return The energy, 0 for a range of 0, or NaN if range_m is negative, NaN or beyond the ranges of the
+ *         searched energies.
+ */
+double solve_energy_from_range(double range_m, int material, int model, EnergySolverHint& hint,
+                               double energy_min_MeV = SOLVER_ENERGY_MIN_MeV,
+                               double energy_max_MeV = SOLVER_ENERGY_MAX_MeV);
+
+/**
+ * @brief Interpolation table of AT_max_electron_range_m for one (material, model) pair.
+ *
+ * The energy range is split into log-spaced intervals, on which the range is approximated by a cubic
+ * Hermite spline built from the exact values and derivatives at the nodes. The number of intervals is
+ * doubled until the relative error, measured against AT_max_electron_range_m at VERIFY_POINTS points
+ * inside every interval, is below rtol on all but a negligible fraction (1/1024) of the intervals.
+ * The intervals which do not meet the bound (e.g. across a kink of a piecewise model), or where the
+ * range is not positive and finite, are evaluated with AT_max_electron_range_m, as are energies outside
+ * of the table.
+ *
+ * The bound is empirical: it is checked on VERIFY_POINTS samples per interval, not derived from bounds of
+ * the derivatives of the model (which libamtrack does not provide), so the error between the samples is
+ * only known to be small for smooth models, not guaranteed to stay below rtol.
+ *
+ * A lookup costs one polynomial evaluation once its interval is known. Lookups take a hint (the
+ * interval of the previous element), so sorted inputs walk from one interval to the next without
+ * computing a logarithm; unsorted inputs locate the interval from the logarithm of the energy.
+ *
+ * The table is also inverted by energy_lookup: when the tabulated ranges increase with the energy, the
+ * energy of a range is found by solving the cubic of its interval, with the accuracy of the table.
+ *
+ * Tables are immutable once built and can be shared between threads.
+ */
+class RangeTable {
+ public:
+  /** Number of points per interval at which the error bound is checked. */
+  static constexpr int VERIFY_POINTS = 16;
+  /** Largest number of intervals tried before giving up on the remaining intervals. */
+  static constexpr size_t MAX_INTERVALS = size_t(1) << 16;
+
+  /**
+   * @brief Builds the table, evaluating AT_max_electron_range_m on the shared thread pool.
+   *
+   * @param material Material ID.
+   * @param model Electron range model ID.
+   * @param options Error bound and tabulated energy range.
+   * @throws std::invalid_argument if the options are invalid.
+   */
+  RangeTable(int material, int model, const RangeTableOptions& options);
+
+  /**
+   * @brief Returns the electron range in meters for the given energy.
+   *
+   * @param energy_MeV Energy in MeV.
+   * @param hint Interval used for the previous lookup, updated to the interval of this one.
+   *             Start with 0; keep one hint per sequence of lookups (e.g. per thread).
+   */
+  double lookup(double energy_MeV, size_t& hint) const {
+    if (!(energy_MeV >= energy_min_ && energy_MeV <= energy_max_)) return exact(energy_MeV);
+
+    size_t i = hint;
+    if (energy_MeV < nodes_[i] || energy_MeV >= nodes_[i + 1]) {
+      // Sorted inputs usually land in the next interval or the one after
+      if (energy_MeV >= nodes_[i + 1] && i + 2 < nodes_.size() && energy_MeV < nodes_[i + 2]) {
+        i += 1;
+      } else {
+        i = locate(energy_MeV);
+      }
+      hint = i;
+    }
+
+    const Interval& c = intervals_[i];
+    if (c.exact) return exact(energy_MeV);
+    double u = (energy_MeV - nodes_[i]) * c.inv_width;
+    return ((c.c3 * u + c.c2) * u + c.c1) * u + c.c0;
+  }
+
+  /**
+   * @brief Returns the energy in MeV whose interpolated range is the given range, the inverse of lookup.
+   *
+   * The interval is found like in lookup (walking from the hint for sorted ranges, else by a binary search
+   * of the tabulated ranges), and its cubic is solved by Newton iterations safeguarded by bisection.
+   * Ranges outside of the table, of intervals evaluated exactly, or of a table whose ranges do not increase
+   * with the energy are solved with solve_energy_from_range.
+   *
+   * @param range_m Range in meters.
+   * @param hint Interval used for the previous lookup, updated to the interval of this one.
+   * @param solver Warm start of solve_energy_from_range, for the ranges solved exactly.
+   */
+  double energy_lookup(double range_m, size_t& hint, EnergySolverHint& solver) const;
+
+  int material() const { return material_; }
+  int model() const { return model_; }
+  const RangeTableOptions& options() const { return options_; }
+
+  /** Number of intervals of the table. */
+  size_t num_intervals() const { return intervals_.size(); }
+
+  /** Number of intervals evaluated exactly because the error bound could not be met on them. */
+  size_t num_exact_intervals() const { return num_exact_; }
+
+  /** Largest relative error found at the sampled points, over the interpolated intervals. */
+  double max_rel_error() const { return max_rel_error_; }
+
+  /** Memory used by the table, in bytes. */
+  size_t memory_bytes() const;
+
+ private:
+  struct Interval {
+    double c0, c1, c2, c3;  // polynomial in u = (E - node) / width
+    double inv_width;
+    bool exact;
+  };
+
+  double exact(double energy_MeV) const;
+  size_t locate(double energy_MeV) const;
+
+  int material_;
+  int model_;
+  RangeTableOptions options_;
+  double energy_min_;
+  double energy_max_;
+  double log_energy_min_;
+  double inv_log_step_;
+  std::vector<double> nodes_;
+  std::vector<double> ranges_;  // range at every node, used by energy_lookup
+  std::vector<Interval> intervals_;
+  bool increasing_ = false;  // whether the ranges at the nodes are positive and increasing
+  size_t num_exact_ = 0;
+  double max_rel_error_ = 0.0;
+};
+
+/**
+ * @brief Returns the cached table of a (material, model) pair, building it with default options on first use.
+ *
+ * The cache is shared by all threads; a table is built outside of the cache lock, so concurrent first
+ * uses of the same pair may build it twice, but only one of the tables is kept.
+ */
+std::shared_ptr<const RangeTable> get_range_table(int material, int model);
+
+/**
+ * @brief Builds the table of a (material, model) pair with the given options and stores it in the cache,
+ * replacing any previous table of that pair.
+ */
+std::shared_ptr<const RangeTable> build_range_table(int material, int model, const RangeTableOptions& options);
+
+/**
+ * @brief Returns all tables currently in the cache.
+ */
+std::vector<std::shared_ptr<const RangeTable>> cached_range_tables();
+
+/**
+ * @brief Removes all tables from the cache. Tables still in use stay valid until released.
+ */
+void clear_range_table_cache();
+
+#endif  // RANGE_TABLE_H
@@ -1,15 +1,20 @@
 #include <nanobind/nanobind.h>
 #include <nanobind/stl/string.h>
 
+#include "../wrapper/async.h"
+#include "../wrapper/module.h"
 #include "electron_range.h"
 
 namespace nb = nanobind;
 
-NB_MODULE(stopping, m) {
+PYAMTRACK_MODULE(stopping, m) {
   m.doc() =
       "Functions for calculating stopping power of ions and protons and range of particles in "
       "materials.";
 
+  // Material arguments are resolved without importing pyamtrack.materials on every call
+  material_type();
+
   // Create submodule for models
   nb::module_ models = m.def_submodule("models", "Stopping power models");
 
@@ -22,14 +27,19 @@ NB_MODULE(stopping, m) {
   m.def("model", &get_model_id, nb::arg("name"), "Returns model ID for given model name");
 
   m.def("electron_range", &electron_range, nb::arg("energy_MeV"), nb::arg("material") = 1, nb::arg("model") = "tabata",
-        nb::arg("cartesian_product") = false,
-        R"pbdoc(
+        nb::arg("cartesian_product") = false, nb::kw_only(), nb::arg("out") = nb::none(), nb::arg("where") = nb::none(),
+        nb::arg("dtype") = nb::none(), nb::arg("mode") = "exact", nb::arg("out_file") = nb::none(),
+        nb::arg("errors") = "raise", R"pbdoc(
         Calculate electron range in meters using various models.
 
         This function calculates the maximum electron range in a material using different theoretical
         or empirical models. The range represents the maximum distance that electrons can travel
         in the material before losing all their energy.
 
+        Unless `cartesian_product` is set, energy, material and model are broadcast against each other
+        following the NumPy rules, e.g. energies of shape (N, 1) and materials of shape (1, M) give
+        ranges of shape (N, M). Scalars are broadcast without being copied.
+
         Parameters
         ----------
         energy_MeV : float or array_like
@@ -48,13 +58,119 @@ NB_MODULE(stopping, m) {
             - "scholz_new" (id=8): Updated Scholz model
         cartesian_product: bool
             Indicates whether to compute cartesian product over passed arguments.
+        out : numpy.ndarray, optional
+            A writable, C-contiguous float64 (or float32) array of the result shape to store the results in.
+            Reusing the same array across calls avoids allocating a new result every time.
+        where : bool or array_like of bool, optional
+            Boolean mask broadcastable to the result shape (e.g. one value per energy of a cartesian
+            product, of shape (n, 1)). Ranges are computed only where it is True; elsewhere `out`
+            keeps its values, or the result holds NaN when `out` is not given.
+        dtype : numpy.dtype, optional
+            Dtype of the result array, numpy.float64 (default) or numpy.float32. float32 halves the
+            memory of large results; ranges are still computed in double precision.
+        mode : str, optional
+            "exact" (default) evaluates the model for every element. "table" interpolates a cached
+            table of the model for every (material, model) pair, built on first use (or with
+            `build_table`) and accurate to a relative error bound (1e-6 by default). The bound is
+            empirical: it is checked at 16 points per interval of the table, not guaranteed between them.
+            Sorted energies are looked up fastest.
+        out_file : str or os.PathLike, optional
+            Path of a .npy file to write the result of a cartesian product into, instead of memory.
+            The file is created (or replaced) with its final size and memory-mapped, then filled from
+            start to end and written back every 64 MB (waiting for the previous 64 MB to be on disk), so
+            results larger than the memory can be computed.
+            The file is removed if the call fails. Cannot be combined with `out`.
+        errors : str, optional
+            Handling of invalid elements: a material or model ID unknown to libamtrack, or a negative or
+            NaN energy. Unknown IDs are found by a validation pass over the inputs before any range is
+            computed; the computation then stores NaN for the invalid elements itself, so only "mask"
+            allocates memory for them.
+            - "raise" (default): raise a ValueError describing the first element with an unknown ID, without
+              computing anything. A negative or NaN energy gives a NaN range.
+            - "nan": the range of invalid elements is NaN, the others are computed normally.
+            - "mask": as "nan", and also return the error code of every element as a uint8 array:
+              0 if valid (or excluded by `where`), ERROR_INVALID_ENERGY (1), ERROR_INVALID_MATERIAL (2)
+              or ERROR_INVALID_MODEL (3).
+
+        Returns
+        -------
+        float or numpy.ndarray
+            The calculated electron range(s) in meters. Returns a float when every argument is a single
+            value, otherwise a NumPy array of the broadcast (or cartesian product) shape, for list inputs
+            as well. When `out` is given, it is returned. When `out_file`
+            is given, the file opened with numpy.load(out_file, mmap_mode="r") is returned.
+            With errors="mask", a tuple (ranges, error codes), the codes being an int for a float range.
+
+        Raises
+        ------
+        TypeError
+            If material argument is neither an integer nor a Material object,
+            or if model argument is neither a string nor an integer.
+        ValueError
+            If a material or model ID is unknown with errors="raise" (the default), a model name is unknown
+            or the argument shapes cannot be broadcast together.
+        OSError
+            If `out_file` cannot be created or written.
+        )pbdoc");
+
+  m.attr("ERROR_INVALID_ENERGY") = ERROR_INVALID_ENERGY;
+  m.attr("ERROR_INVALID_MATERIAL") = ERROR_INVALID_MATERIAL;
+  m.attr("ERROR_INVALID_MODEL") = ERROR_INVALID_MODEL;
+  m.attr("ERROR_INVALID_RANGE") = ERROR_INVALID_RANGE;
+
+  m.def("energy_from_electron_range", &energy_from_electron_range, nb::arg("range_m"), nb::arg("material") = 1,
+        nb::arg("model") = "tabata", nb::arg("cartesian_product") = false, nb::kw_only(), nb::arg("out") = nb::none(),
+        nb::arg("where") = nb::none(), nb::arg("dtype") = nb::none(), nb::arg("mode") = "exact",
+        nb::arg("out_file") = nb::none(), nb::arg("errors") = "raise", R"pbdoc(
+        Calculate the electron energy in MeV whose maximum electron range is the given range.
+
+        The inverse of electron_range, e.g. for energy cut-offs and track structure radii, taking the same
+        argument forms: ranges, materials and models are broadcast against each other, or combined with
+        `cartesian_product`, exactly as the energies, materials and models of electron_range.
+
+        Every energy is solved natively, in log-log space where the range is nearly a power of the energy:
+        Newton steps bracket the solution, which is then narrowed by regula falsi to a relative accuracy of
+        about 1e-12. Each solution warm-starts the next one of the same material and model, so sorted (or
+        clustered) ranges need about three evaluations of the model per energy.
+
+        Parameters
+        ----------
+        range_m : float or array_like
+            The electron range in meters. Can be a single value, a NumPy array, or a Python list.
+        material : int, Material, list[int | Material] or numpy array with int as dtype, optional
+            Either a material ID as integer or a Material object. Defaults to 1 (Liquid water).
+        model : str, int, list[int | str] or numpy array with int as dtype, optional
+            The model, as in electron_range. Defaults to "tabata".
+        cartesian_product: bool
+            Indicates whether to compute cartesian product over passed arguments.
+        out : numpy.ndarray, optional
+            A writable, C-contiguous float64 (or float32) array of the result shape to store the results in.
+        where : bool or array_like of bool, optional
+            Boolean mask broadcastable to the result shape (e.g. one value per energy of a cartesian
+            product, of shape (n, 1)). Energies are computed only where it is True; elsewhere `out`
+            keeps its values, or the result holds NaN when `out` is not given.
+        dtype : numpy.dtype, optional
+            Dtype of the result array, numpy.float64 (default) or numpy.float32.
+        mode : str, optional
+            "exact" (default) solves with the model itself. "table" inverts the cached table of every
+            (material, model) pair used by electron_range(..., mode="table"), solving the interpolating
+            cubic of the interval of each range: the energies are as accurate as the table (1e-6 by
+            default), at the cost of a few polynomial evaluations. Ranges outside of the table, or where
+            the table is evaluated exactly, are solved with the model.
+        out_file : str or os.PathLike, optional
+            Path of a .npy file to write the result of a cartesian product into, as in electron_range.
+        errors : str, optional
+            Handling of invalid elements: a material or model ID unknown to libamtrack, or a negative or
+            NaN range, as in electron_range. "raise" (default) raises for an unknown ID and gives NaN for a
+            negative or NaN range. With "mask", the codes are 0, ERROR_INVALID_RANGE (1),
+            ERROR_INVALID_MATERIAL (2) or ERROR_INVALID_MODEL (3).
 
         Returns
         -------
         float or numpy.ndarray
-            The calculated electron range(s) in meters. Returns a float for a single input,
-            a NumPy array for a NumPy array input, a Python list for a list input and a NumPy array
-            when computing a cartesian product.
+            The energies in MeV: a float for scalar inputs, otherwise a NumPy array (or `out`, or the file
+            opened from `out_file`). A range of 0 gives 0, ranges which no energy between 1e-6 MeV and 1e6 MeV
+            reaches give NaN. With errors="mask", a tuple (energies, error codes).
 
         Raises
         ------
@@ -62,6 +178,162 @@ NB_MODULE(stopping, m) {
             If material argument is neither an integer nor a Material object,
             or if model argument is neither a string nor an integer.
         ValueError
-            If the input energy is negative or the model/material ID is invalid.
+            If a material or model ID is unknown with errors="raise" (the default), a model name is unknown
+            or the argument shapes cannot be broadcast together.
+
+        Examples
+        --------
+        >>> energy_from_electron_range(electron_range(1.0))  # 1 MeV, to about 1e-12
+        >>> energy_from_electron_range(np.geomspace(1e-9, 1e-2, 10**6), [1, 2], cartesian_product=True)
+        )pbdoc");
+
+  m.def("build_table", &build_table, nb::arg("material") = 1, nb::arg("model") = "tabata", nb::kw_only(),
+        nb::arg("rtol") = 1e-6, nb::arg("energy_min_MeV") = 1e-3, nb::arg("energy_max_MeV") = 1e4, R"pbdoc(
+        Build the electron range table of a material and model used with mode="table".
+
+        The table interpolates the electron range on log-spaced energy intervals, refined until the
+        relative error against the exact model, checked at 16 points per interval, is below `rtol`.
+        The few intervals where the bound cannot be met (e.g. across a kink of a piecewise model),
+        and energies outside of the table, are evaluated exactly. The bound is empirical: it holds at
+        the checked points, and between them only as far as the model is smooth. The table replaces
+        any cached table of the same material and model.
+
+        Parameters
+        ----------
+        material : int or Material, optional
+            Material ID or Material object. Defaults to 1 (Liquid water).
+        model : str or int, optional
+            Model name or ID. Defaults to "tabata".
+        rtol : float, optional
+            Relative error bound of the interpolated ranges, checked at 16 points per interval.
+        energy_min_MeV, energy_max_MeV : float, optional
+            Energy range covered by the table.
+
+        Returns
+        -------
+        dict
+            Description of the table, as returned by `table_cache_info`.
+        )pbdoc");
+
+  m.def("table_cache_info", &table_cache_info, R"pbdoc(
+        Describe the cached electron range tables.
+
+        Returns
+        -------
+        list of dict
+            One dict per table with keys material, model, rtol, energy_min_MeV, energy_max_MeV,
+            intervals, exact_intervals, max_rel_error and memory_bytes.
         )pbdoc");
+
+  m.def("clear_table_cache", &clear_table_cache, "Removes all cached electron range tables");
+
+  nb::class_<ElectronRangeIterator>(m, "ElectronRangeIterator",
+                                    "Iterator over the blocks of an electron range cartesian product, see "
+                                    "electron_range_iter")
+      .def("__iter__", [](nb::handle self) { return self; })
+      .def("__next__", &ElectronRangeIterator::next, nb::lock_self());
+
+  m.def(
+      "electron_range_iter",
+      [](const nb::object& energy_MeV, const nb::object& material, const nb::object& model, bool cartesian_product,
+         size_t chunk_elements, const nb::object& dtype, const std::string& mode) {
+        if (!cartesian_product) {
+          throw nb::value_error(
+              "electron_range_iter evaluates cartesian products only, use electron_range for broadcasting.");
+        }
+        return ElectronRangeIterator(energy_MeV, material, model, chunk_elements, dtype, mode);
+      },
+      nb::arg("energy_MeV"), nb::arg("material") = 1, nb::arg("model") = "tabata",
+      nb::arg("cartesian_product") = true, nb::kw_only(), nb::arg("chunk_elements") = DEFAULT_CHUNK_ELEMENTS,
+      nb::arg("dtype") = nb::none(), nb::arg("mode") = "exact", R"pbdoc(
+        Evaluate the electron range cartesian product block by block, in bounded memory.
+
+        Equivalent to electron_range(energy_MeV, material, model, cartesian_product=True), without ever
+        allocating the full result: the ranges are computed lazily, for a few energies at a time. Use it for
+        sweeps whose result does not fit in memory, or to stream energies through a pipeline.
+
+        Parameters
+        ----------
+        energy_MeV : float, array_like or iterable
+            The electron energies in MeV: a single value, a list, a NumPy array (flattened in C order),
+            or any other iterable, e.g. a generator, yielding chunks of energies (floats, lists or arrays).
+            Chunks are read one at a time, when the previous one has been evaluated.
+        material : int, Material or array_like, optional
+            The material(s), as in electron_range. Default is 1 (water).
+        model : str, int or array_like, optional
+            The model(s), as in electron_range. Default is "tabata".
+        cartesian_product : bool, optional
+            Must be True (the default); accepted for symmetry with electron_range.
+        chunk_elements : int, optional
+            Largest number of ranges in a block (default 2**20). A block holds at least one energy,
+            so it may be larger when a single energy gives more results.
+        dtype : numpy.dtype, optional
+            Dtype of the blocks, numpy.float64 (default) or numpy.float32.
+        mode : str, optional
+            "exact" (default) or "table", as in electron_range.
+
+        Yields
+        ------
+        tuple of (slice, numpy.ndarray)
+            The slice selects the energies of the block along the first axis of the full result, of shape
+            (number of energies, *material shape, *model shape); the block holds their ranges.
+
+        Examples
+        --------
+        >>> ranges = np.empty((1000, 2))
+        >>> for index, block in electron_range_iter(np.linspace(1, 100, 1000), [1, 2], chunk_elements=500):
+        ...     ranges[index] = block
+    )pbdoc");
+
+  // Asynchronous variants call the module function on a background thread
+  const std::string module_name = nb::cast<std::string>(m.attr("__name__"));
+  m.def(
+      "electron_range_async",
+      [module_name](nb::args args, nb::kwargs kwargs) {
+        return submit_async(nb::module_::import_(module_name.c_str()).attr("electron_range"), args, kwargs);
+      },
+      R"pbdoc(
+        Start computing electron_range on a background thread and return a future of its result.
+
+        Takes the same arguments as electron_range and returns at once. The ranges are computed on a
+        background thread of pyamtrack, without the GIL, so the calling thread keeps running and several
+        calls are computed at the same time. The arguments are referenced until the call is finished:
+        arrays passed as inputs or as `out` must not be modified before the future is done.
+
+        Returns
+        -------
+        concurrent.futures.Future
+            The future of the result of electron_range, or of the exception it raised.
+
+        Examples
+        --------
+        >>> future = electron_range_async(np.linspace(1, 100, 10**7), [1, 2], cartesian_product=True)
+        >>> ...  # other work
+        >>> ranges = future.result()
+    )pbdoc");
+
+  m.def(
+      "electron_range_aio",
+      [module_name](nb::args args, nb::kwargs kwargs) {
+        nb::object function = nb::module_::import_(module_name.c_str()).attr("electron_range");
+        return nb::module_::import_("asyncio").attr("wrap_future")(submit_async(function, args, kwargs));
+      },
+      R"pbdoc(
+        Compute electron_range on a background thread, as an awaitable for asyncio.
+
+        Takes the same arguments as electron_range. Must be called from a running event loop, which
+        keeps serving other coroutines while the ranges are computed (see electron_range_async).
+
+        Returns
+        -------
+        asyncio.Future
+            The awaitable result of electron_range.
+
+        Examples
+        --------
+        >>> ranges = await electron_range_aio(energies, materials)
+    )pbdoc");
+
+  // Pending calls are finished before the interpreter shuts down
+  nb::module_::import_("atexit").attr("register")(nb::cpp_function(&wait_async_calls));
 }
@@ -0,0 +1,78 @@
+#ifndef WRAPPER_ASYNC_H
+#define WRAPPER_ASYNC_H
+
+#include <nanobind/nanobind.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "../runtime/thread_pool.h"
+
+namespace nb = nanobind;
+
+/**
+ * A call submitted by submit_async. Its objects, including the input arrays referenced by the arguments,
+ * are kept alive until the call is finished, and are released by the background thread with the GIL held.
+ */
+struct AsyncCall {
+  nb::object function;
+  nb::object args;
+  nb::object kwargs;
+  nb::object future;
+};
+
+/**
+ * Runs an AsyncCall on a background thread and stores its result or exception in its future.
+ */
+inline void run_async_call(AsyncCall& pending) {
+  nb::gil_scoped_acquire acquire;
+  AsyncCall call = std::move(pending);
+  try {
+    // A future cancelled before the call started is not run
+    if (!nb::cast<bool>(call.future.attr("set_running_or_notify_cancel")())) return;
+    PyObject* result = PyObject_Call(call.function.ptr(), call.args.ptr(), call.kwargs.ptr());
+    if (result) {
+      call.future.attr("set_result")(nb::steal(result));
+    } else {
+      nb::python_error error;
+      call.future.attr("set_exception")(error.value());
+    }
+  } catch (nb::python_error& e) {
+    // Only reached if the future itself fails, e.g. when a done callback raises
+    e.discard_as_unraisable("pyamtrack asynchronous call");
+  }
+}
+
+/**
+ * Calls function(*args, **kwargs) on a background thread of pyamtrack (see submit_task) and returns a
+ * concurrent.futures.Future of its result.
+ *
+ * The call returns at once. The function parses its arguments and builds its result with the GIL, which
+ * the vectorized functions of pyamtrack release while computing, so the calling thread (e.g. an asyncio
+ * event loop) keeps running, and independent calls are computed concurrently. Exceptions are set on the
+ * future. The arguments are referenced until the call is finished; arrays passed as inputs or `out` must
+ * not be modified before the future is done.
+ *
+ * @param function The Python callable to call, e.g. a function of a pyamtrack module.
+ * @param args     The positional arguments.
+ * @param kwargs   The keyword arguments.
+ * @return         A concurrent.futures.Future, which can be awaited with asyncio.wrap_future.
+ */
+inline nb::object submit_async(const nb::object& function, const nb::args& args, const nb::kwargs& kwargs) {
+  nb::object future = nb::module_::import_("concurrent.futures").attr("Future")();
+  auto call = std::make_shared<AsyncCall>(AsyncCall{function, args, kwargs, future});
+  submit_task([call]() { run_async_call(*call); });
+  return future;
+}
+
+/**
+ * Waits for all asynchronous calls, without the GIL. Registered with atexit by the modules offering
+ * asynchronous functions, so no background thread needs the GIL once the interpreter is finalized.
+ */
+inline void wait_async_calls() {
+  nb::gil_scoped_release release;
+  wait_tasks();
+}
+
+#endif
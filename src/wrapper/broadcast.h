@@ -0,0 +1,199 @@
+#ifndef WRAPPER_BROADCAST_H
+#define WRAPPER_BROADCAST_H
+
+#include <nanobind/nanobind.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "column.h"
+#include "output.h"
+
+namespace nb = nanobind;
+
+/**
+ * Layout of several columns broadcast against each other following the NumPy rules.
+ *
+ * Shapes are aligned on their last axis; along every output axis each column either has the output
+ * length or length 1. Broadcasting never copies data: a column is repeated along an axis by giving it
+ * a stride of 0 there, so a scalar is read from the same element for every output index.
+ */
+struct BroadcastLayout {
+  std::vector<size_t> shape;                  /**< Shape of the output. */
+  std::vector<std::vector<int64_t>> strides;  /**< Per column, its element stride along every output axis. */
+  size_t size = 1;                            /**< Number of elements of the output. */
+
+  /**
+   * Whether every column is either read in output order or constant over the output, in which case the
+   * offset of column c for output index i is simply flat_step[c] * i (contiguous fast path).
+   */
+  bool flat = false;
+  std::vector<int64_t> flat_step; /**< Per column, 1 (read in output order) or 0 (constant), valid when flat. */
+};
+
+/**
+ * Computes the size of the layout and detects whether it can be walked with plain indexing.
+ * Must be called once shape and strides are set.
+ */
+inline void finish_layout(BroadcastLayout& layout) {
+  layout.size = 1;
+  for (size_t dim : layout.shape) layout.size *= dim;
+
+  layout.flat = true;
+  layout.flat_step.clear();
+  for (const auto& strides : layout.strides) {
+    bool linear = true, constant = true;
+    int64_t expected = 1;
+    for (size_t axis = layout.shape.size(); axis-- > 0;) {
+      // Strides along axes of length 1 are never used
+      if (layout.shape[axis] != 1) {
+        linear = linear && strides[axis] == expected;
+        constant = constant && strides[axis] == 0;
+      }
+      expected *= static_cast<int64_t>(layout.shape[axis]);
+    }
+    layout.flat = layout.flat && (linear || constant);
+    layout.flat_step.push_back(constant ? 0 : 1);
+  }
+}
+
+/**
+ * Computes the broadcast output shape of the columns and the stride of every column along each output axis.
+ *
+ * @param columns  The columns to broadcast, their shape and strides describe their elements.
+ * @return         The output shape and the strides to iterate over it.
+ *
+ * @throws nb::value_error if the shapes cannot be broadcast together.
+ */
+inline BroadcastLayout broadcast_columns(const std::vector<Column>& columns) {
+  BroadcastLayout layout;
+
+  size_t ndim = 0;
+  for (const auto& column : columns) ndim = std::max(ndim, column.shape.size());
+  layout.shape.assign(ndim, 1);
+
+  for (const auto& column : columns) {
+    size_t offset = ndim - column.shape.size();
+    for (size_t i = 0; i < column.shape.size(); ++i) {
+      size_t& dim = layout.shape[offset + i];
+      if (dim == 1) {
+        dim = column.shape[i];
+      } else if (column.shape[i] != 1 && column.shape[i] != dim) {
+        std::string message = "operands could not be broadcast together with shapes";
+        for (const auto& c : columns) message += " " + shape_to_string(c.shape);
+        throw nb::value_error(message.c_str());
+      }
+    }
+  }
+
+  for (const auto& column : columns) {
+    size_t offset = ndim - column.shape.size();
+    std::vector<int64_t> strides(ndim, 0);
+    for (size_t i = 0; i < column.shape.size(); ++i) {
+      // Axes of length 1 are repeated, so they never advance through the column
+      if (column.shape[i] != 1) strides[offset + i] = column.strides[i];
+    }
+    layout.strides.push_back(std::move(strides));
+  }
+
+  finish_layout(layout);
+  return layout;
+}
+
+/**
+ * Layout of the cartesian product of the columns: the output shape is the concatenation of their shapes
+ * and every column spans its own output axes, with a zero stride along the axes of the others.
+ */
+inline BroadcastLayout cartesian_layout(const std::vector<Column>& columns) {
+  BroadcastLayout layout;
+  for (const auto& column : columns) layout.shape.insert(layout.shape.end(), column.shape.begin(), column.shape.end());
+
+  size_t first_axis = 0;
+  for (const auto& column : columns) {
+    std::vector<int64_t> strides(layout.shape.size(), 0);
+    std::copy(column.strides.begin(), column.strides.end(), strides.begin() + first_axis);
+    first_axis += column.shape.size();
+    layout.strides.push_back(std::move(strides));
+  }
+  finish_layout(layout);
+  return layout;
+}
+
+/**
+ * Layout reading a single column in C order over its own shape.
+ */
+inline BroadcastLayout column_layout(const Column& column) {
+  BroadcastLayout layout;
+  layout.shape = column.shape;
+  layout.strides.push_back(column.strides);
+  finish_layout(layout);
+  return layout;
+}
+
+/**
+ * Walks the output of a BroadcastLayout in C order, keeping track of the element offset of every column.
+ *
+ * The iterator can start at any output index, so a range of the output can be processed independently
+ * of the others (e.g. by one thread). Advancing costs one addition per column in the common case.
+ */
+class BroadcastIterator {
+ public:
+  /**
+   * @param layout  The layout to iterate over; must outlive the iterator.
+   * @param start   Flat (C order) output index of the first element.
+   */
+  BroadcastIterator(const BroadcastLayout& layout, size_t start)
+      : layout_(layout), index_(layout.shape.size(), 0), offsets_(layout.strides.size(), 0) {
+    size_t remainder = start;
+    for (size_t axis = layout_.shape.size(); axis-- > 0;) {
+      index_[axis] = remainder % layout_.shape[axis];
+      remainder /= layout_.shape[axis];
+      for (size_t c = 0; c < offsets_.size(); ++c) offsets_[c] += layout_.strides[c][axis] * index_[axis];
+    }
+  }
+
+  /** Element offset of the current output element in every column. */
+  const std::vector<int64_t>& offsets() const { return offsets_; }
+
+  /** Moves to the next output element. */
+  void next() {
+    for (size_t axis = layout_.shape.size(); axis-- > 0;) {
+      if (++index_[axis] < layout_.shape[axis]) {
+        for (size_t c = 0; c < offsets_.size(); ++c) offsets_[c] += layout_.strides[c][axis];
+        return;
+      }
+      index_[axis] = 0;
+      for (size_t c = 0; c < offsets_.size(); ++c) {
+        offsets_[c] -= layout_.strides[c][axis] * static_cast<int64_t>(layout_.shape[axis] - 1);
+      }
+    }
+  }
+
+ private:
+  const BroadcastLayout& layout_;
+  std::vector<size_t> index_;
+  std::vector<int64_t> offsets_;
+};
+
+/**
+ * Calls body(i, offsets) for every output index i in [begin, end), where offsets[c] is the element offset
+ * of column c for that output element. Flat layouts are walked with plain indexing, others with a
+ * BroadcastIterator.
+ */
+template <typename Body>
+inline void for_each_broadcast(const BroadcastLayout& layout, size_t begin, size_t end, Body&& body) {
+  if (layout.flat) {
+    std::vector<int64_t> offsets(layout.flat_step.size());
+    for (size_t i = begin; i < end; ++i) {
+      for (size_t c = 0; c < offsets.size(); ++c) offsets[c] = layout.flat_step[c] * static_cast<int64_t>(i);
+      body(i, offsets);
+    }
+    return;
+  }
+  BroadcastIterator it(layout, begin);
+  for (size_t i = begin; i < end; ++i, it.next()) body(i, it.offsets());
+}
+
+#endif
@@ -5,103 +5,40 @@
 
 #include <vector>
 
+#include "../runtime/stats.h"
+#include "../runtime/thread_pool.h"
+#include "broadcast.h"
+#include "column.h"
+#include "output.h"
 #include "types.h"
-#include "utils.h"
 
 namespace nb = nanobind;
 
 /**
- * Flattens a NumPy array (ndarray) or scalar into a 1-dimensional vector of nb::object.
- * Records the original shape of the array in output_shape, except for 0-dimensional arrays.
- * Ensures the array is C-contiguous (row-major); raises a value_error otherwise.
- *
- * @tparam T             The element type of the ndarray.
- * @param argument       A nanobind handle representing the input ndarray or scalar.
- * @param array_inputs   Vector of vectors to which the flattened array is appended.
- * @param output_shape   Vector to record the shape of the input array.
- *
- * @throws nb::value_error if an input is not a non C-contigous Numpy array
- */
-template <typename T>
-inline void process_array(nb::handle argument, std::vector<std::vector<nb::object>>& array_inputs,
-                          std::vector<size_t>& output_shape) {
-  auto arr = nb::cast<nb::ndarray<T>>(argument);
-  if (!is_c_contiguous(arr)) {
-    throw nb::value_error(
-        "NDArray must be C-contiguous. "
-        "Use numpy.ascontiguousarray(your_array) before passing it.");
-  }
-
-  if (arr.ndim() == 0) {
-    // scalar ndarray
-    T* ptr = arr.data();
-    array_inputs.push_back({nb::cast(ptr[0])});
-  } else {
-    // flatten NDarray and record its original shape
-    std::vector<nb::object> tmp;
-    tmp.reserve(arr.size());
-
-    for (size_t i = 0; i < arr.ndim(); ++i) {
-      output_shape.push_back(arr.shape(i));
-    }
-
-    T* ptr = arr.data();
-    for (size_t i = 0; i < arr.size(); ++i) {
-      tmp.push_back(nb::cast(ptr[i]));
-    }
-    array_inputs.push_back(std::move(tmp));
-  }
-}
-
-/**
- * Parses a sequence of Python arguments (lists, ndarrays, or scalars) into a unified
- * internal representation for later cartesian product computation.
+ * Parses a sequence of Python arguments (lists, ndarrays, or scalars) into typed columns
+ * for later cartesian product computation.
  *
  * @param input   Vector of nanobind objects, each representing a function argument
  *                (list, ndarray, or scalar).
  * @return        A pair consisting of:
- *                  - array_inputs: a vector of vectors of nb::object, each representing
- *                                  one argument’s expanded elements.
- *                  - output_shape: a vector of sizes (one per input) describing the
- *                                  number of elements from each argument.
+ *                  - columns:      one typed column per argument, viewing or holding its elements.
+ *                  - output_shape: the concatenation of the shapes of all list and ndarray arguments,
+ *                                  scalars and 0-D arrays do not contribute to it.
  *
  * @throws nb::type_error if an input is not a float, int, list, or NumPy array.
  */
-inline std::pair<std::vector<std::vector<nb::object>>, std::vector<size_t>> parse_input(
-    const std::vector<nb::object>& input) {
-  std::vector<std::vector<nb::object>> array_inputs;
+inline std::pair<std::vector<Column>, std::vector<size_t>> parse_input(const std::vector<nb::object>& input) {
+  std::vector<Column> columns;
   std::vector<size_t> output_shape;
 
-  array_inputs.reserve(input.size());
+  columns.reserve(input.size());
 
   for (const auto& argument : input) {
-    // 1. Check for list
-    if (nb::isinstance<nb::list>(argument)) {
-      auto list = nb::cast<nb::list>(argument);
-      std::vector<nb::object> tmp;
-      tmp.reserve(nb::len(list));
-      for (auto item : list) tmp.push_back(nb::cast(item));
-      array_inputs.push_back(std::move(tmp));
-
-      output_shape.push_back(nb::len(list));
-    }
-    // 2. Check for ndarray
-    else if (nb::isinstance<nb::ndarray<>>(argument)) {
-      if (check_int_dtype(argument)) {
-        process_array<long long>(argument, array_inputs, output_shape);
-      } else {
-        process_array<double>(argument, array_inputs, output_shape);
-      }
-
-      // 3. Check for scalar
-    } else if (nb::isinstance<nb::float_>(argument) || nb::isinstance<nb::int_>(argument)) {
-      array_inputs.push_back({argument});
-    } else {
-      // Handle unsupported types
-      throw nb::type_error("Input must be a float, int, list, or NumPy array.");
-    }
+    Column column = make_column(argument);
+    output_shape.insert(output_shape.end(), column.shape.begin(), column.shape.end());
+    columns.push_back(std::move(column));
   }
-  return {array_inputs, output_shape};
+  return {std::move(columns), std::move(output_shape)};
 }
 
 /**
@@ -113,83 +50,86 @@ inline std::pair<std::vector<std::vector<nb::object>>, std::vector<size_t>> pars
  * @param func   The multi-argument function to apply. It should accept a vector of std::variant<double, int>.
  * @param input  A vector of nanobind objects, each representing an argument. Each argument can be a scalar,
  *               list, or ndarray. Lists and ndarrays are expanded; scalars are treated as single values.
+ * @param out    None, or a writable C-contiguous float64 ndarray of the output shape to store the results in.
+ * @param where  None, a bool, or a boolean array broadcastable to the output shape;
+ *               `func` is only evaluated where it is true.
+ * @param dtype  None, numpy.float64 or numpy.float32: the dtype of the result (see dispatch_output_dtype).
+ * @param out_file None, or the path of a .npy file to write the results into instead of memory (see OutputBuffer).
  * @return       A nested nanobind list (nb::object) containing the results of applying func to each
- *               combination of arguments from the cartesian product.
+ *               combination of arguments from the cartesian product, `out` if it was provided, or
+ *               the file opened as a read-only memory map.
  *
  * @throws nb::type_error if input array contents are not integers or floats
+ * @throws OSError if `out_file` cannot be created or written
+ *
+ * All arguments are unpacked into typed columns up front, so the loop over the cartesian product
+ * reads raw values only and never calls back into the Python C API. The loop runs on the shared
+ * thread pool (see parallel_for) with the GIL released.
  *
  * Differs from wrap_multiargument_function in that this function computes the cartesian product of argument
  * lists/arrays, applying the function to every possible combination, whereas wrap_multiargument_function
  * applies the function to a single set of arguments (possibly vectorized).
  */
-inline nb::object wrap_cartesian_product_function(const MultiargumentFunc& func, const std::vector<nb::object>& input) {
+inline nb::object wrap_cartesian_product_function(const MultiargumentFunc& func, const std::vector<nb::object>& input,
+                                                  const nb::object& out = nb::none(),
+                                                  const nb::object& where = nb::none(),
+                                                  const nb::object& dtype = nb::none(),
+                                                  const nb::object& out_file = nb::none()) {
   // Parse the input object
-  auto [array_inputs, output_shape] = parse_input(input);
-
-  // Record the size of every input, return empty np.array in case any of the inputs is empty
-  std::vector<size_t> shape;
-
-  for (const auto& input_vector : array_inputs) {
-    size_t size = input_vector.size();
-    if (size == 0) {
-      return nb::ndarray<double, nb::numpy>(nullptr, {0}).cast();
-    }
-    shape.push_back(size);
-  }
-
-  // Initialize the vector of pointers and compute the number of elements in the output
-  size_t num_inputs = shape.size();
-  std::vector<size_t> index_pointers(num_inputs, 0);
-  size_t output_size = 1;
-
-  for (size_t i = 0; i < num_inputs; ++i) {
-    output_size *= shape[i];
-  }
-
-  // Iterate through all the combinations and fill the array with functions output
-  double* results = new double[output_size];
-  std::vector<std::variant<double, int>> args(num_inputs);
-
-  auto assign_val = [&](nb::handle val, int j) {
-    if (nb::isinstance<nb::float_>(val)) {
-      args[j] = nb::cast<double>(val);
-    } else if (nb::isinstance<nb::int_>(val)) {
-      args[j] = nb::cast<int>(val);
-    } else {
-      throw nb::type_error("All arguments must be int or float at the deepest level.");
+  // (not a structured binding: those cannot be captured by lambdas in C++17)
+  auto parsed = parse_input(input);
+  const std::vector<Column>& columns = parsed.first;
+  const std::vector<size_t>& output_shape = parsed.second;
+
+  // Return empty np.array in case any of the inputs is empty
+  for (const auto& column : columns) {
+    if (column.size == 0) {
+      return dispatch_output_dtype(dtype, out, [&](auto output_type) {
+        OutputBuffer<typename decltype(output_type)::type> empty(out, {0}, out_file);
+        return empty.result();
+      });
     }
-  };
-
-  for (size_t j = 0; j < num_inputs; ++j) {
-    auto val = array_inputs[j][index_pointers[j]];
-    assign_val(val, j);
   }
 
-  results[0] = func(args);
-
-  for (size_t i = 1; i < output_size; ++i) {
-    size_t j = num_inputs - 1;
-
-    while (j > 0 && index_pointers[j] >= shape[j] - 1) {
-      index_pointers[j] = 0;
-      auto val = array_inputs[j][index_pointers[j]];
-      assign_val(val, j);
-      --j;
+  // The cartesian product is a broadcast where every argument spans its own output axes
+  BroadcastLayout layout = cartesian_layout(columns);
+
+  // Iterate through all the combinations and fill the array with functions output.
+  // The output is split into chunks evaluated on the thread pool without the GIL; each chunk
+  // starts from the combination matching its first index and then only advances the offsets
+  // of the arguments whose index changed.
+  return dispatch_output_dtype(dtype, out, [&](auto output_type) {
+    using Out = typename decltype(output_type)::type;
+    OutputBuffer<Out> output(out, output_shape, out_file);
+    WhereMask mask = make_where_mask(where, output_shape);
+    Out* results_buffer = output.data();
+    const bool fill_masked = !output.is_user_provided();
+
+    auto compute_chunk = [&](size_t begin, size_t end) {
+      std::vector<std::variant<double, int>> args(columns.size());
+      BroadcastIterator it(layout, begin);
+      WhereCursor selected(mask, begin);
+      for (size_t i = begin; i < end; ++i, it.next()) {
+        if (!selected.next()) {
+          if (fill_masked) results_buffer[i] = static_cast<Out>(MASKED_VALUE);
+          continue;
+        }
+        const auto& offsets = it.offsets();
+        for (size_t j = 0; j < columns.size(); ++j) args[j] = columns[j].value(offsets[j]);
+        results_buffer[i] = static_cast<Out>(func(args));
+      }
+    };
+
+    {
+      StatsComputePhase phase(layout.size);
+      nb::gil_scoped_release release;
+      output.fill_in_order(layout.size, 1, [&](size_t first, size_t last) {
+        parallel_for(last - first, [&](size_t begin, size_t end) { compute_chunk(first + begin, first + end); });
+      });
     }
 
-    index_pointers[j] += 1;
-    auto val = array_inputs[j][index_pointers[j]];
-    assign_val(val, j);
-
-    results[i] = func(args);
-  }
-
-  // Transform the raw pointer and return nb::ndarray
-  nb::capsule owner(results, [](void* p) noexcept { delete[] (double*)p; });
-
-  auto result_array =
-      nb::ndarray<double, nb::numpy>(results, output_shape.size(), output_shape.data(), owner).cast();
-  return result_array;
+    return output.result();
+  });
 }
 
 #endif
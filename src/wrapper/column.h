@@ -0,0 +1,235 @@
+#ifndef WRAPPER_COLUMN_H
+#define WRAPPER_COLUMN_H
+
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "../runtime/stats.h"
+#include "utils.h"
+
+namespace nb = nanobind;
+
+/**
+ * Typed, unboxed view over the elements of a single function argument.
+ *
+ * A column is built once, while the GIL is held, from a Python scalar, list or NumPy array.
+ * NumPy buffers are viewed in place through raw pointers in their native dtype (the ndarray is kept
+ * alive by `owner`), while scalars and list elements are unpacked into a small typed vector owned by
+ * the column. After construction, reading values never touches the Python C API.
+ *
+ * Floating point and integral element types are kept apart, which preserves the distinction between
+ * e.g. energies and material or model ids. Elements are converted to the type expected by the wrapped
+ * function only when they are read, so float32 or int32 arrays are never copied into wider buffers.
+ */
+struct Column {
+  enum class Kind { Float64, Float32, Int64, Int32, Int16, Int8, UInt64, UInt32, UInt16, UInt8 };
+
+  Kind kind = Kind::Float64;
+  const void* data = nullptr;   /**< Element data, of the type given by kind. */
+  size_t size = 0;              /**< Number of elements. */
+  std::vector<size_t> shape;    /**< Shape contributed to the output, empty for scalars and 0-D arrays. */
+  std::vector<int64_t> strides; /**< Element stride along each axis of shape. */
+
+  std::shared_ptr<void> owner;      /**< Keeps the viewed ndarray (and any converted copy) alive. */
+  std::vector<double> f64_storage;  /**< Owned storage for scalars and lists of floats. */
+  std::vector<int64_t> i64_storage; /**< Owned storage for scalars and lists of ints. */
+
+  Column() = default;
+  Column(Column&&) = default;
+  Column& operator=(Column&&) = default;
+  // Copies would leave data pointing into the storage of the source column
+  Column(const Column&) = delete;
+  Column& operator=(const Column&) = delete;
+
+  /**
+   * Calls visitor with the element data as a typed pointer (e.g. `const float*`) and returns its result.
+   * The visitor is instantiated for every element type, so loops inside it are compiled per dtype.
+   */
+  template <typename Visitor>
+  decltype(auto) visit(Visitor&& visitor) const {
+    switch (kind) {
+      case Kind::Float32:
+        return visitor(static_cast<const float*>(data));
+      case Kind::Int64:
+        return visitor(static_cast<const int64_t*>(data));
+      case Kind::Int32:
+        return visitor(static_cast<const int32_t*>(data));
+      case Kind::Int16:
+        return visitor(static_cast<const int16_t*>(data));
+      case Kind::Int8:
+        return visitor(static_cast<const int8_t*>(data));
+      case Kind::UInt64:
+        return visitor(static_cast<const uint64_t*>(data));
+      case Kind::UInt32:
+        return visitor(static_cast<const uint32_t*>(data));
+      case Kind::UInt16:
+        return visitor(static_cast<const uint16_t*>(data));
+      case Kind::UInt8:
+        return visitor(static_cast<const uint8_t*>(data));
+      case Kind::Float64:
+      default:
+        return visitor(static_cast<const double*>(data));
+    }
+  }
+
+  /**
+   * Returns the element at the given offset (in elements, see strides) as a variant, keeping its int or double
+   * type. The offset is signed, as it is negative for the elements of a view with negative strides.
+   */
+  std::variant<double, int> value(int64_t offset) const {
+    return visit([offset](const auto* elements) -> std::variant<double, int> {
+      using T = std::remove_const_t<std::remove_pointer_t<decltype(elements)>>;
+      if constexpr (std::is_floating_point_v<T>) {
+        return static_cast<double>(elements[offset]);
+      } else {
+        return static_cast<int>(elements[offset]);
+      }
+    });
+  }
+};
+
+/**
+ * Column kind holding elements of type T.
+ */
+template <typename T>
+constexpr Column::Kind column_kind() {
+  if constexpr (std::is_same_v<T, float>) return Column::Kind::Float32;
+  if constexpr (std::is_same_v<T, int64_t>) return Column::Kind::Int64;
+  if constexpr (std::is_same_v<T, int32_t>) return Column::Kind::Int32;
+  if constexpr (std::is_same_v<T, int16_t>) return Column::Kind::Int16;
+  if constexpr (std::is_same_v<T, int8_t>) return Column::Kind::Int8;
+  if constexpr (std::is_same_v<T, uint64_t>) return Column::Kind::UInt64;
+  if constexpr (std::is_same_v<T, uint32_t>) return Column::Kind::UInt32;
+  if constexpr (std::is_same_v<T, uint16_t>) return Column::Kind::UInt16;
+  if constexpr (std::is_same_v<T, uint8_t>) return Column::Kind::UInt8;
+  return Column::Kind::Float64;
+}
+
+/**
+ * Points a column at its owned storage, setting the element type and size accordingly.
+ */
+inline void bind_storage(Column& column, Column::Kind kind) {
+  column.kind = kind;
+  if (kind == Column::Kind::Float64) {
+    column.data = column.f64_storage.data();
+    column.size = column.f64_storage.size();
+    stats_allocation(column.f64_storage.capacity() * sizeof(double));
+  } else {
+    column.data = column.i64_storage.data();
+    column.size = column.i64_storage.size();
+    stats_allocation(column.i64_storage.capacity() * sizeof(int64_t));
+  }
+}
+
+/**
+ * Builds a column viewing the buffer of a NumPy array with elements of type T.
+ * When the array dtype is not T, NumPy converts it once, without creating Python objects per element.
+ *
+ * Strided views (slices, transposed or Fortran-ordered arrays) are viewed in place: their strides
+ * are recorded in the column instead of copying the data into a contiguous buffer.
+ *
+ * @throws nb::type_error  if the array dtype cannot be converted.
+ */
+template <typename T>
+inline Column make_array_column(nb::handle argument) {
+  nb::ndarray<const T> arr;
+  try {
+    arr = nb::cast<nb::ndarray<const T>>(argument);
+  } catch (const nb::cast_error&) {
+    throw nb::type_error("NumPy array dtype cannot be cast to double or input is not suitable.");
+  }
+
+  Column column;
+  column.kind = column_kind<T>();
+  column.data = arr.data();
+  column.size = arr.size();
+  // 0-D arrays behave like scalars and do not contribute to the output shape
+  for (size_t i = 0; i < arr.ndim(); ++i) {
+    column.shape.push_back(arr.shape(i));
+    column.strides.push_back(arr.stride(i));
+  }
+  column.owner = std::make_shared<nb::ndarray<const T>>(std::move(arr));
+  return column;
+}
+
+/**
+ * Builds a column viewing a NumPy array in its own dtype when it is a float32/float64 or (unsigned)
+ * integer dtype, without any conversion copy. Arrays of other dtypes (e.g. bool or float16) are
+ * converted to float64.
+ *
+ * @throws nb::type_error  if the array dtype cannot be converted.
+ */
+inline Column make_native_array_column(nb::handle argument) {
+  nb::dlpack::dtype dtype = nb::cast<nb::ndarray<>>(argument).dtype();
+  if (dtype == nb::dtype<double>()) return make_array_column<double>(argument);
+  if (dtype == nb::dtype<float>()) return make_array_column<float>(argument);
+  if (dtype == nb::dtype<int64_t>()) return make_array_column<int64_t>(argument);
+  if (dtype == nb::dtype<int32_t>()) return make_array_column<int32_t>(argument);
+  if (dtype == nb::dtype<int16_t>()) return make_array_column<int16_t>(argument);
+  if (dtype == nb::dtype<int8_t>()) return make_array_column<int8_t>(argument);
+  if (dtype == nb::dtype<uint64_t>()) return make_array_column<uint64_t>(argument);
+  if (dtype == nb::dtype<uint32_t>()) return make_array_column<uint32_t>(argument);
+  if (dtype == nb::dtype<uint16_t>()) return make_array_column<uint16_t>(argument);
+  if (dtype == nb::dtype<uint8_t>()) return make_array_column<uint8_t>(argument);
+  return make_array_column<double>(argument);
+}
+
+/**
+ * Builds a typed column from a Python scalar (float or int), list or NumPy array.
+ * Lists made only of ints become Int64 columns; lists containing at least one float become Float64 columns.
+ *
+ * @param argument  A nanobind handle representing the function argument.
+ * @return          The column holding (or viewing) the argument elements.
+ *
+ * @throws nb::type_error  if the argument is not a float, int, list, or NumPy array,
+ *                         or if a list contains anything other than ints and floats.
+ */
+inline Column make_column(nb::handle argument) {
+  Column column;
+
+  if (nb::isinstance<nb::list>(argument)) {
+    auto list = nb::borrow<nb::list>(argument);
+    size_t length = nb::len(list);
+
+    bool all_ints = true;
+    for (nb::handle item : list) {
+      if (PyFloat_Check(item.ptr())) {
+        all_ints = false;
+      } else if (!PyLong_Check(item.ptr())) {
+        throw nb::type_error("All arguments must be int or float at the deepest level.");
+      }
+    }
+
+    if (all_ints) {
+      column.i64_storage.reserve(length);
+      for (nb::handle item : list) column.i64_storage.push_back(nb::cast<int64_t>(item));
+      bind_storage(column, Column::Kind::Int64);
+    } else {
+      column.f64_storage.reserve(length);
+      for (nb::handle item : list) column.f64_storage.push_back(nb::cast<double>(item));
+      bind_storage(column, Column::Kind::Float64);
+    }
+    column.shape.push_back(length);
+    column.strides.push_back(1);
+  } else if (nb::isinstance<nb::ndarray<>>(argument)) {
+    column = make_native_array_column(argument);
+  } else if (PyFloat_Check(argument.ptr())) {
+    column.f64_storage.push_back(nb::cast<double>(argument));
+    bind_storage(column, Column::Kind::Float64);
+  } else if (PyLong_Check(argument.ptr())) {
+    column.i64_storage.push_back(nb::cast<int64_t>(argument));
+    bind_storage(column, Column::Kind::Int64);
+  } else {
+    throw nb::type_error("Input must be a float, int, list, or NumPy array.");
+  }
+
+  return column;
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef WRAPPER_ERRORS_H
+#define WRAPPER_ERRORS_H
+
+#include <nanobind/nanobind.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../runtime/thread_pool.h"
+#include "broadcast.h"
+#include "column.h"
+#include "output.h"
+
+namespace nb = nanobind;
+
+/**
+ * Handling of invalid input elements (e.g. unknown ids) by a vectorized call, selected with its `errors=`
+ * argument in the spirit of numpy.errstate.
+ *
+ * Invalid elements are found by a validation pass over the inputs before anything is computed, so a large
+ * call either fails at once, or completes in a single pass with NaN as the result of the invalid elements.
+ * The computation itself stores NaN for them, so only ErrorPolicy::Mask allocates per-element codes.
+ */
+enum class ErrorPolicy {
+  Raise, /**< Raise a ValueError describing the first invalid element. */
+  Nan,   /**< Store NaN as the result of every invalid element. */
+  Mask,  /**< As Nan, and also return a uint8 array of the error code of every element. */
+};
+
+/** Error code of a valid element, or of an element excluded by `where`. */
+constexpr uint8_t ERROR_NONE = 0;
+
+/**
+ * Parses the `errors=` argument of a vectorized call.
+ *
+ * @throws nb::value_error if `errors` is not "raise", "nan" or "mask".
+ */
+inline ErrorPolicy parse_error_policy(const std::string& errors) {
+  if (errors == "raise") return ErrorPolicy::Raise;
+  if (errors == "nan") return ErrorPolicy::Nan;
+  if (errors == "mask") return ErrorPolicy::Mask;
+  throw nb::value_error(("errors must be \"raise\", \"nan\" or \"mask\", got \"" + errors + "\".").c_str());
+}
+
+/**
+ * Whether valid(value) is true for every element of a column, its elements converted to T.
+ * The column is scanned on the shared thread pool; this is the cheap check done before computing codes.
+ * Does not call into Python and should be called without the GIL.
+ */
+template <typename T, typename Valid>
+inline bool column_all_of(const Column& column, Valid&& valid) {
+  const BroadcastLayout layout = column_layout(column);
+  std::atomic<bool> invalid{false};
+  parallel_for(layout.size, [&](size_t begin, size_t end) {
+    column.visit([&](const auto* elements) {
+      for_each_broadcast(layout, begin, end, [&](size_t, const std::vector<int64_t>& offsets) {
+        if (!valid(static_cast<T>(elements[offsets[0]]))) invalid.store(true, std::memory_order_relaxed);
+      });
+    });
+  });
+  return !invalid.load();
+}
+
+/**
+ * Computes the error code of every element of the output of a layout.
+ * Does not call into Python and should be called without the GIL.
+ *
+ * @param code   Called with the column offsets of an output element, returns its error code (ERROR_NONE if valid).
+ * @param mask   The `where=` mask of the call; excluded elements get ERROR_NONE.
+ * @param codes  The codes of the output elements, in C order, or nullptr to only find the first invalid element.
+ * @return       The index of the first invalid element, or layout.size if all elements are valid.
+ */
+template <typename Code>
+inline size_t compute_error_codes(const BroadcastLayout& layout, const WhereMask& mask, uint8_t* codes, Code&& code) {
+  std::atomic<size_t> first{layout.size};
+  parallel_for(layout.size, [&](size_t begin, size_t end) {
+    size_t local_first = layout.size;
+    WhereCursor selected(mask, begin);
+    for_each_broadcast(layout, begin, end, [&](size_t i, const std::vector<int64_t>& offsets) {
+      const uint8_t element_code = selected.next() ? code(offsets) : ERROR_NONE;
+      if (codes) codes[i] = element_code;
+      if (element_code != ERROR_NONE && local_first == layout.size) local_first = i;
+    });
+    size_t current = first.load();
+    while (local_first < current && !first.compare_exchange_weak(current, local_first)) {
+    }
+  });
+  return first.load();
+}
+
+#endif
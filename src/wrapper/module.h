@@ -0,0 +1,19 @@
+#ifndef WRAPPER_MODULE_H
+#define WRAPPER_MODULE_H
+
+#include <nanobind/nanobind.h>
+
+/**
+ * Defines the bindings of the pyamtrack submodule `name`, filling the nb::module_ `variable`.
+ *
+ * By default every submodule is an extension module of its own (NB_MODULE). When built with
+ * PYAMTRACK_SINGLE_MODULE, it defines the function init_<name>(nb::module_&) instead, which the single
+ * pyamtrack._core extension calls to fill the submodule pyamtrack.<name> (see src/main.cpp).
+ */
+#ifdef PYAMTRACK_SINGLE_MODULE
+#define PYAMTRACK_MODULE(name, variable) void init_##name(nanobind::module_& variable)
+#else
+#define PYAMTRACK_MODULE(name, variable) NB_MODULE(name, variable)
+#endif
+
+#endif
@@ -5,64 +5,61 @@
 
 #include <vector>
 
+#include "../runtime/stats.h"
+#include "../runtime/thread_pool.h"
+#include "broadcast.h"
+#include "column.h"
+#include "output.h"
 #include "types.h"
-#include "utils.h"
 
 namespace nb = nanobind;
 
-/**
- * Prepares a 1-D NumPy array filled with copies of a scalar value.
- * @param scalar  A Python scalar (int or float) to be broadcasted.
- * @param shape   The size of the resulting 1-D NumPy array.
- * @return        A 1-D nb::ndarray<double> where all elements are equal to `scalar`.
- */
-inline nb::object prepare_array_argument(const nb::object& scalar, std::size_t shape) {
-  double* results = new double[shape];
-  for (std::size_t i = 0; i < shape; i++) {
-    results[i] = nb::cast<double>(scalar);
-  }
-
-  nb::capsule owner(results, [](void* p) noexcept { delete[] (double*)p; });
-  auto result_array = nb::ndarray<double, nb::numpy>(results, {shape}, owner).cast();
-  return result_array;
-}
-
 /**
  * Wraps a multi-argument function to support vectorized or scalar inputs.
- * The function returns either a single scalar (if all inputs were scalars) or a
- * 1-D NumPy array of results corresponding to each set of arguments.
+ * The arguments are broadcast against each other following the NumPy rules, e.g. an energy array of
+ * shape (N, 1) and a material array of shape (1, M) give an (N, M) result. The function returns either
+ * a single scalar (if all inputs were scalars) or a NumPy array of the broadcast shape.
  *
  * @param func   The multi-argument function to wrap. Accepts a vector of
  *               std::variant<double, int> and returns a double.
- * @param input  Vector of nb::object representing the arguments (scalars, lists, or 1-D arrays).
- * @return       Either a scalar nb::object (if all inputs are scalars) or a 1-D
+ * @param input  Vector of nb::object representing the arguments (scalars, lists, or NumPy arrays).
+ * @param out    None, or a writable C-contiguous float64 ndarray of the result shape to store the results in.
+ * @param where  None, a bool, or a boolean array broadcastable to the result shape;
+ *               `func` is only evaluated where it is true.
+ * @param dtype  None, numpy.float64 or numpy.float32: the dtype of the result (see dispatch_output_dtype).
+ * @return       Either a scalar nb::object (if all inputs are scalars) or an
  *               nb::ndarray<double> containing results of `func` applied element-wise.
+ *               If `out` was provided, it is returned instead (0-D when all inputs are scalars).
+ *
+ * @throws nb::type_error  If any input is not a float, int, list, or NumPy array.
+ * @throws nb::value_error If the input shapes cannot be broadcast together, `out` has the wrong shape,
+ *                         `where` does not broadcast to it, or `dtype` is not a supported result dtype.
+ * @throws std::runtime_error For other errors during processing of NumPy arrays.
  *
- * @throws nb::type_error  If any input is not a float, int, list, or 1-D NumPy array.
- * @throws nb::value_error If lists/arrays have incompatible lengths.
- * @throws std::runtime_error For other errors during processing of 1-D arrays.
+ * Lists and arrays are unpacked into typed columns while the GIL is held; the results are then computed
+ * on the shared thread pool (see parallel_for) with the GIL released, so `func` must not call into the
+ * Python C API. Broadcasting reads repeated elements in place through zero strides: scalars and arrays
+ * of length 1 along an axis are never expanded into temporary arrays. Strided array views are read in
+ * place as well.
+ *
+ * When the wrapped function is known at compile time, prefer wrap_vectorized (see vectorized.h), which has the
+ * same semantics without the per-element std::function call and std::variant conversions.
  */
-inline nb::object wrap_multiargument_function(const MultiargumentFunc& func, const std::vector<nb::object>& input) {
+inline nb::object wrap_multiargument_function(const MultiargumentFunc& func, const std::vector<nb::object>& input,
+                                              const nb::object& out = nb::none(),
+                                              const nb::object& where = nb::none(),
+                                              const nb::object& dtype = nb::none()) {
   // Check for scalar types (float or int)
   bool scalars_only = true;
-  size_t input_length = 0;  // length of input if it is not a scalar
   for (const auto& argument : input) {
-    if (nb::isinstance<nb::list>(argument)) {
-      auto list = nb::cast<nb::list>(argument);
-      input_length = nb::len(list);
-      scalars_only = false;
-      break;
-    } else if (nb::isinstance<nb::ndarray<>>(argument)) {
-      auto array = nb::cast<nb::ndarray<>>(argument);
-      input_length = array.size();
+    if (nb::isinstance<nb::list>(argument) || nb::isinstance<nb::ndarray<>>(argument)) {
       scalars_only = false;
-      break;
     } else if (!nb::isinstance<nb::float_>(argument) && !nb::isinstance<nb::int_>(argument)) {
       // Handle unsupported types
-      throw nb::type_error("Input must be a float, int, list, or 0-D/1-D NumPy array.");
+      throw nb::type_error("Input must be a float, int, list, or NumPy array.");
     }
   }
-  if (scalars_only) {
+  if (scalars_only && out.is_none() && where.is_none() && dtype.is_none()) {
     // there is no array or list argument
     std::vector<std::variant<double, int>> input_casted;
     input_casted.reserve(input.size());
@@ -73,65 +70,50 @@ inline nb::object wrap_multiargument_function(const MultiargumentFunc& func, con
         input_casted.emplace_back(nb::cast<int>(argument));
       }
     }
-    double result = func(input_casted);
+    double result;
+    {
+      StatsComputePhase phase(1);
+      result = func(input_casted);
+    }
     return nb::cast(result);
   }
-  // Check for Python list and / or arrays
-  else {
-    // there is at least one list or array argument. input_length is length of the first one, others should have the
-    // same shape.
-    std::vector<nb::object> arguments;
-    for (const auto& input_element : input) {
-      if (nb::isinstance<nb::float_>(input_element) || nb::isinstance<nb::int_>(input_element))
-        arguments.push_back(prepare_array_argument(input_element, (int)input_length));
-      else if (nb::isinstance<nb::list>(input_element)) {
-        arguments.push_back(input_element);
-        if (nb::len(nb::cast<nb::list>(input_element)) != input_length)
-          throw nb::value_error("Incompatible lists/arrays size");
-      } else if (nb::isinstance<nb::ndarray<>>(input_element)) {
-        // First, cast to a generic ndarray to check ndim and size
-        auto array_generic = nb::cast<nb::ndarray<>>(input_element);
-        if (array_generic.ndim() != 1) throw nb::value_error("Input NumPy array must be 1-D.");
 
-        // Now safely cast to the required type
-        auto array = nb::cast<nb::ndarray<const double, nb::shape<-1>>>(input_element);
-        arguments.push_back(input_element);
-        if (array.size() != input_length) throw nb::value_error("Incompatible lists/arrays size");
-      } else {
-        // Handle unsupported types
-        throw nb::type_error("Input must be a float, int, list, or 0-D/1-D NumPy array.");
-      }
-    }
+  // Scalars become 0-D columns; with out= or where= an all-scalar call yields a 0-D result
+  std::vector<Column> columns;
+  columns.reserve(input.size());
+  for (const auto& input_element : input) columns.push_back(make_column(input_element));
+
+  BroadcastLayout layout = broadcast_columns(columns);
+  return dispatch_output_dtype(dtype, out, [&](auto output_type) {
+    using Out = typename decltype(output_type)::type;
+    OutputBuffer<Out> output(out, layout.shape);
+    WhereMask mask = make_where_mask(where, layout.shape);
 
-    double* results = new double[input_length];
     try {
-      for (size_t i = 0; i < input_length; i++) {
-        std::vector<std::variant<double, int>> arguments_vector;
-        for (auto& argument : arguments) {
-          if (nb::isinstance<nb::list>(argument)) {
-            if (PyFloat_Check(argument[i].ptr()))
-              arguments_vector.emplace_back(nb::cast<double>(argument[i]));
-            else {
-              arguments_vector.emplace_back(nb::cast<int>(argument[i]));
-            }
-          } else {
-            auto array = nb::cast<nb::ndarray<const double, nb::shape<-1>>>(argument);
-            arguments_vector.emplace_back(array(i));
+      StatsComputePhase phase(layout.size);
+      nb::gil_scoped_release release;
+      Out* results = output.data();
+      const bool fill_masked = !output.is_user_provided();
+      parallel_for(layout.size, [&](size_t begin, size_t end) {
+        std::vector<std::variant<double, int>> arguments_vector(columns.size());
+        WhereCursor selected(mask, begin);
+        for_each_broadcast(layout, begin, end, [&](size_t i, const std::vector<int64_t>& offsets) {
+          if (!selected.next()) {
+            if (fill_masked) results[i] = static_cast<Out>(MASKED_VALUE);
+            return;
           }
-        }
-        results[i] = func(arguments_vector);
-      }
-    } catch (const nb::cast_error& e) {
-      throw nb::type_error("1-D NumPy array dtype cannot be cast to double or input is not suitable.");
+          for (size_t j = 0; j < columns.size(); ++j) {
+            arguments_vector[j] = columns[j].value(offsets[j]);
+          }
+          results[i] = static_cast<Out>(func(arguments_vector));
+        });
+      });
     } catch (const std::exception& e) {
-      throw std::runtime_error("Error processing 1-D NumPy array: " + std::string(e.what()));
+      throw std::runtime_error("Error processing NumPy array: " + std::string(e.what()));
     }
 
-    nb::capsule owner(results, [](void* p) noexcept { delete[] (double*)p; });
-
-    auto result_array = nb::ndarray<double, nb::numpy>(results, {input_length}, owner).cast();
-    return result_array;
-  }
+    return output.result();
+  });
 }
 
 #endif
@@ -0,0 +1,356 @@
+#ifndef WRAPPER_OUTPUT_H
+#define WRAPPER_OUTPUT_H
+
+#include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "../runtime/npy_file.h"
+#include "../runtime/stats.h"
+
+namespace nb = nanobind;
+
+/**
+ * Formats a shape the way NumPy prints it, e.g. "(3, 4)" or "(5,)".
+ */
+inline std::string shape_to_string(const std::vector<size_t>& shape) {
+  std::string result = "(";
+  for (size_t i = 0; i < shape.size(); ++i) {
+    if (i > 0) result += ", ";
+    result += std::to_string(shape[i]);
+  }
+  if (shape.size() == 1) result += ",";
+  return result + ")";
+}
+
+/**
+ * Returns the shape of an ndarray as a vector.
+ */
+template <typename... Args>
+inline std::vector<size_t> array_shape(const nb::ndarray<Args...>& array) {
+  std::vector<size_t> shape(array.ndim());
+  for (size_t i = 0; i < array.ndim(); ++i) shape[i] = array.shape(i);
+  return shape;
+}
+
+/**
+ * Name of the NumPy dtype of results stored as T.
+ */
+template <typename T>
+constexpr const char* dtype_name() {
+  return std::is_same_v<T, float> ? "float32" : "float64";
+}
+
+/**
+ * Destination of the results of a vectorized call, following the NumPy `out=` convention.
+ *
+ * When `out` is None, a new buffer of T (float64 or float32) is allocated and handed over to NumPy by result().
+ * Otherwise the results are written directly into the caller-provided array, which must be a writable,
+ * C-contiguous ndarray of dtype T and of the expected shape, and result() returns that same array.
+ * This allows loops calling the same function repeatedly to run without any allocation.
+ *
+ * With `out_file`, the results are written into a new memory-mapped .npy file instead (see MappedNpyFile),
+ * which result() returns opened with numpy.load(out_file, mmap_mode="r"). Results larger than memory can
+ * be computed this way, provided they are filled with fill_in_order.
+ */
+template <typename T>
+class OutputBuffer {
+ public:
+  /**
+   * @param out      None, or the array to write the results into.
+   * @param shape    The shape of the result.
+   * @param out_file None, or the path (str or os.PathLike) of a .npy file to write the results into.
+   *
+   * @throws nb::type_error  if `out` is not a writable, C-contiguous NumPy array of dtype T.
+   * @throws nb::value_error if `out` does not have the expected shape, or both `out` and `out_file` are given.
+   * @throws OSError         if the file cannot be created.
+   */
+  OutputBuffer(const nb::object& out, const std::vector<size_t>& shape, const nb::object& out_file = nb::none())
+      : shape_(shape) {
+    size_t size = 1;
+    for (size_t dim : shape_) size *= dim;
+
+    if (!out_file.is_none()) {
+      if (!out.is_none()) throw nb::value_error("out and out_file cannot be given together.");
+      std::string path = nb::cast<std::string>(nb::module_::import_("os").attr("fspath")(out_file));
+      try {
+        file_.reset(new MappedNpyFile(path, std::is_same_v<T, float> ? "f4" : "f8", shape_, sizeof(T)));
+      } catch (const std::system_error& e) {
+        PyErr_SetString(PyExc_OSError, e.what());
+        throw nb::python_error();
+      }
+      data_ = static_cast<T*>(file_->data());
+      return;
+    }
+
+    if (out.is_none()) {
+      storage_.reset(new T[size]);
+      stats_allocation(size * sizeof(T));
+      data_ = storage_.get();
+      return;
+    }
+
+    nb::ndarray<T, nb::c_contig> array;
+    try {
+      // No conversion: results have to land in the caller's memory
+      array = nb::cast<nb::ndarray<T, nb::c_contig>>(out, false);
+    } catch (const nb::cast_error&) {
+      throw nb::type_error(
+          (std::string("out must be a writable, C-contiguous NumPy array of dtype ") + dtype_name<T>() + ".").c_str());
+    }
+    if (array_shape(array) != shape_) {
+      throw nb::value_error(("out has shape " + shape_to_string(array_shape(array)) + ", but the result has shape " +
+                             shape_to_string(shape_) + ".")
+                                .c_str());
+    }
+    data_ = array.data();
+    out_ = out;
+  }
+
+  /** Pointer to the first element of the result, in C order. */
+  T* data() const { return data_; }
+
+  /** Whether the results are written into a caller-provided array. */
+  bool is_user_provided() const { return out_.is_valid(); }
+
+  /**
+   * Calls fill(begin, end) on consecutive ranges of result indices covering [0, size), each a multiple of
+   * `step` elements long. When writing to a file, every range is written back once filled (see
+   * MappedNpyFile::flush), so the file is written sequentially and the dirty pages stay bounded to about two
+   * ranges of NPY_FLUSH_BYTES, whatever the size of the result; otherwise fill is called
+   * once for all indices.
+   *
+   * fill is called without the GIL when the caller released it, and flushing does not need it.
+   */
+  template <typename Fill>
+  void fill_in_order(size_t size, size_t step, Fill&& fill) {
+    if (!file_) {
+      fill(size_t(0), size);
+      return;
+    }
+    step = std::max<size_t>(step, 1);
+    const size_t range = std::max<size_t>(1, NPY_FLUSH_BYTES / sizeof(T) / step) * step;
+    for (size_t begin = 0; begin < size; begin += range) {
+      size_t end = std::min(size, begin + range);
+      fill(begin, end);
+      file_->flush(begin * sizeof(T), end * sizeof(T));
+    }
+  }
+
+  /**
+   * Returns the result array: the caller-provided `out`, a new ndarray owning the allocated buffer,
+   * or the written file opened as a read-only memory map. Must be called at most once.
+   */
+  nb::object result() {
+    if (out_.is_valid()) return out_;
+    if (file_) {
+      try {
+        file_->close();
+      } catch (const std::system_error& e) {
+        PyErr_SetString(PyExc_OSError, e.what());
+        throw nb::python_error();
+      }
+      return nb::module_::import_("numpy").attr("load")(file_->path(), nb::arg("mmap_mode") = "r");
+    }
+    nb::capsule owner(storage_.get(), [](void* p) noexcept { delete[] (T*)p; });
+    T* data = storage_.release();
+    return nb::ndarray<T, nb::numpy>(data, shape_.size(), shape_.data(), owner).cast();
+  }
+
+ private:
+  std::vector<size_t> shape_;
+  std::unique_ptr<T[]> storage_;
+  T* data_ = nullptr;
+  nb::object out_;
+  std::unique_ptr<MappedNpyFile> file_;
+};
+
+/**
+ * Tag selecting the element type of the results, see dispatch_output_dtype.
+ */
+template <typename T>
+struct OutputType {
+  using type = T;
+};
+
+/**
+ * Calls body with OutputType<float> or OutputType<double>, following the NumPy `dtype=` convention
+ * for the results of a vectorized call, and returns its result.
+ *
+ * float32 results halve the memory and bandwidth of large outputs where single precision is sufficient;
+ * the wrapped functions still compute in double precision.
+ *
+ * @param dtype  None, or the requested result dtype: numpy.float64 or numpy.float32 (or their names).
+ *               When None, the results are float32 if `out` is a float32 array, float64 otherwise.
+ * @param out    The `out=` argument of the call.
+ *
+ * @throws nb::value_error if `dtype` is neither float64 nor float32.
+ */
+template <typename Body>
+inline nb::object dispatch_output_dtype(const nb::object& dtype, const nb::object& out, Body&& body) {
+  bool single_precision = false;
+  if (!dtype.is_none()) {
+    nb::module_ numpy = nb::module_::import_("numpy");
+    std::string name = nb::cast<std::string>(numpy.attr("dtype")(dtype).attr("name"));
+    if (name != "float64" && name != "float32") {
+      throw nb::value_error(("dtype must be float64 or float32, got " + name + ".").c_str());
+    }
+    single_precision = name == "float32";
+  } else if (!out.is_none()) {
+    single_precision = nb::isinstance<nb::ndarray<float>>(out);
+  }
+  if (single_precision) return body(OutputType<float>{});
+  return body(OutputType<double>{});
+}
+
+/**
+ * Element mask following the NumPy `where=` convention: results are computed only where it is true.
+ *
+ * Elements where the mask is false keep their previous value when writing into `out`,
+ * and are set to NaN in a newly allocated result. The mask is read with a WhereCursor.
+ */
+struct WhereMask {
+  const bool* data = nullptr;    /**< Per-element mask in C order, nullptr when the mask is uniform. */
+  bool uniform = true;           /**< Value of the mask when data is nullptr. */
+  std::shared_ptr<void> owner;   /**< Keeps the mask array alive. */
+  std::vector<size_t> shape;     /**< Result shape, when the mask is broadcast to it. */
+  std::vector<int64_t> strides;  /**< Element strides of a broadcast mask along the result axes, 0 where repeated. */
+
+  /** Whether every element is selected, i.e. the mask can be ignored. */
+  bool all() const { return !data && uniform; }
+};
+
+/**
+ * Reads a WhereMask over result indices in C order: next() returns the mask of the current element and moves
+ * `step` elements further.
+ *
+ * A broadcast mask is walked like a BroadcastIterator, so moving on costs one addition in the common case
+ * instead of decoding every index.
+ */
+class WhereCursor {
+ public:
+  /**
+   * @param mask   The mask to read; must outlive the cursor.
+   * @param start  Flat (C order) result index of the first element.
+   * @param step   Distance between consecutive elements: 1, or the number of elements of some trailing axes of
+   *               the result, whose index then stays the same.
+   */
+  WhereCursor(const WhereMask& mask, size_t start, size_t step = 1) : mask_(mask), step_(step) {
+    if (mask_.strides.empty()) {
+      offset_ = static_cast<int64_t>(start);
+      return;
+    }
+    index_.assign(mask_.shape.size(), 0);
+    size_t remainder = start;
+    for (size_t axis = mask_.shape.size(); axis-- > 0;) {
+      index_[axis] = remainder % mask_.shape[axis];
+      remainder /= mask_.shape[axis];
+      offset_ += mask_.strides[axis] * static_cast<int64_t>(index_[axis]);
+    }
+    // Only the axes in front of the trailing ones spanning `step` elements advance
+    axes_ = mask_.shape.size();
+    for (size_t trailing = 1; axes_ > 0 && trailing < step_;) trailing *= mask_.shape[--axes_];
+  }
+
+  /** Returns the mask of the current element and moves to the next one. */
+  bool next() {
+    if (!mask_.data) return mask_.uniform;
+    const bool selected = mask_.data[offset_];
+    if (mask_.strides.empty()) {
+      offset_ += static_cast<int64_t>(step_);
+      return selected;
+    }
+    for (size_t axis = axes_; axis-- > 0;) {
+      if (++index_[axis] < mask_.shape[axis]) {
+        offset_ += mask_.strides[axis];
+        return selected;
+      }
+      index_[axis] = 0;
+      offset_ -= mask_.strides[axis] * static_cast<int64_t>(mask_.shape[axis] - 1);
+    }
+    return selected;
+  }
+
+ private:
+  const WhereMask& mask_;
+  size_t step_;
+  size_t axes_ = 0;
+  std::vector<size_t> index_;
+  int64_t offset_ = 0;
+};
+
+/**
+ * Parses the `where=` argument of a vectorized call.
+ *
+ * @param where  None or a bool (applies to all elements), or a boolean array-like which broadcasts to the
+ *               result shape, following the NumPy rules. A broadcast mask is read with zero strides along
+ *               its repeated axes, without being copied.
+ * @param shape  The shape of the result.
+ *
+ * @throws nb::type_error  if `where` cannot be interpreted as a boolean array.
+ * @throws nb::value_error if `where` cannot be broadcast to the result shape.
+ */
+inline WhereMask make_where_mask(const nb::object& where, const std::vector<size_t>& shape) {
+  WhereMask mask;
+  if (where.is_none()) return mask;
+  if (PyBool_Check(where.ptr())) {
+    mask.uniform = nb::cast<bool>(where);
+    return mask;
+  }
+
+  nb::object where_array = where;
+  if (!nb::isinstance<nb::ndarray<>>(where)) {
+    nb::module_ numpy = nb::module_::import_("numpy");
+    where_array = numpy.attr("asarray")(where, numpy.attr("bool_"));
+  }
+
+  nb::ndarray<const bool, nb::c_contig> array;
+  try {
+    array = nb::cast<nb::ndarray<const bool, nb::c_contig>>(where_array);
+  } catch (const nb::cast_error&) {
+    throw nb::type_error("where must be a bool or a boolean NumPy array.");
+  }
+
+  if (array.ndim() == 0) {
+    mask.uniform = array.data()[0];
+    return mask;
+  }
+  const std::vector<size_t> mask_shape = array_shape(array);
+  if (mask_shape != shape) {
+    // Broadcast to the result shape: shapes are aligned on their last axis, axes of length 1 are repeated
+    bool broadcastable = mask_shape.size() <= shape.size();
+    const size_t first_axis = shape.size() - std::min(mask_shape.size(), shape.size());
+    mask.shape = shape;
+    mask.strides.assign(shape.size(), 0);
+    int64_t stride = 1;
+    for (size_t i = mask_shape.size(); broadcastable && i-- > 0;) {
+      const size_t axis = first_axis + i;
+      broadcastable = mask_shape[i] == 1 || mask_shape[i] == shape[axis];
+      if (mask_shape[i] != 1) mask.strides[axis] = stride;
+      stride *= static_cast<int64_t>(mask_shape[i]);
+    }
+    if (!broadcastable) {
+      throw nb::value_error(("where has shape " + shape_to_string(mask_shape) +
+                             ", which cannot be broadcast to the result shape " + shape_to_string(shape) + ".")
+                                .c_str());
+    }
+  }
+  mask.data = array.data();
+  mask.owner = std::make_shared<nb::ndarray<const bool, nb::c_contig>>(std::move(array));
+  return mask;
+}
+
+/**
+ * Value stored in newly allocated results for elements excluded by `where`.
+ */
+constexpr double MASKED_VALUE = std::numeric_limits<double>::quiet_NaN();
+
+#endif
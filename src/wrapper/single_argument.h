@@ -5,94 +5,206 @@
 #include <nanobind/ndarray.h>
 #include <nanobind/stl/vector.h>
 
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "../runtime/stats.h"
+#include "../runtime/thread_pool.h"
+#include "broadcast.h"
+#include "column.h"
+#include "output.h"
 #include "types.h"
 #include "utils.h"
 
 namespace nb = nanobind;
 
+/**
+ * Number of elements converted to double at a time when a batch kernel is called on arrays of other dtypes.
+ */
+constexpr size_t BATCH_RUN = 256;
+
+/**
+ * Evaluates a batch kernel on the elements [begin, end) of a contiguous input, storing the results in
+ * the same elements of `results`. Inputs and results of other types than double are converted in runs
+ * of BATCH_RUN elements through buffers on the stack.
+ */
+template <typename In, typename Out>
+inline void evaluate_batch(BatchFunc batch, const In* input, Out* results, size_t begin, size_t end) {
+  if constexpr (std::is_same_v<In, double> && std::is_same_v<Out, double>) {
+    batch(input + begin, results + begin, end - begin);
+  } else {
+    double values[BATCH_RUN];
+    double batch_results[BATCH_RUN];
+    for (size_t run = begin; run < end; run += BATCH_RUN) {
+      const size_t n = std::min(BATCH_RUN, end - run);
+      for (size_t i = 0; i < n; ++i) values[i] = static_cast<double>(input[run + i]);
+      batch(values, batch_results, n);
+      for (size_t i = 0; i < n; ++i) results[run + i] = static_cast<Out>(batch_results[i]);
+    }
+  }
+}
+
 /**
  * Wraps a single-argument C++ function to support scalar, Python list, or NumPy array inputs.
  *
  * @param func   A single-argument function of type `Func` (e.g., `double func(double)`).
  * @param input  A Python object representing the argument. Can be a float, int, list, or ndarray.
+ * @param out    None, or a writable C-contiguous float64 ndarray of the result shape to store the results in.
+ * @param where  None, a bool, or a boolean array broadcastable to the result shape;
+ *               `func` is only evaluated where it is true.
+ * @param dtype  None, numpy.float64 or numpy.float32: the dtype of the result (see dispatch_output_dtype).
+ * @param batch  Optional kernel evaluating `func` on contiguous blocks (see BatchFunc), used for lists and
+ *               contiguous arrays without a `where` mask. Scalars are always evaluated with `func`.
  * @return       The result of applying `func`:
  *                 - scalar nb::object if input is scalar
  *                 - nb::list if input is a Python list
- *                 - nb::ndarray<double> if input is a NumPy array
+ *                 - nb::ndarray of the requested dtype (float64 by default) if input is a NumPy array
+ *                 - `out` itself if it was provided
  *
  * @throws nb::type_error  If the input or list elements are not numeric, or if ndarray dtype cannot be cast to double.
- * @throws nb::value_error If a NumPy array is not C-contiguous.
+ * @throws nb::value_error If `out` has the wrong shape,
+ *                         `where` does not broadcast to it, or `dtype` is not a supported result dtype.
  * @throws std::runtime_error For other errors during processing of NumPy arrays.
+ *
+ * Lists and arrays are evaluated on the shared thread pool (see parallel_for) with the GIL released,
+ * so `func` must not call into the Python C API. Strided arrays (slices, transposed or Fortran-ordered
+ * arrays) are read in place through their strides; C-contiguous arrays take a plain indexing fast path.
+ * float32, float64 and integer arrays are read in their own dtype, without a conversion copy.
  */
-inline nb::object wrap_function(Func func, const nb::object& input) {
+inline nb::object wrap_function(Func func, const nb::object& input, const nb::object& out = nb::none(),
+                                const nb::object& where = nb::none(), const nb::object& dtype = nb::none(),
+                                BatchFunc batch = nullptr) {
+  const bool plain_call = out.is_none() && where.is_none() && dtype.is_none();
+
   // 1. Check for scalar types (float or int)
   if (PyFloat_Check(input.ptr()) || PyLong_Check(input.ptr())) {
     double input_val = nb::cast<double>(input);
-    double result = func(input_val);
-    return nb::cast(result);
+    if (plain_call) {
+      double result;
+      {
+        StatsComputePhase phase(1);
+        result = func(input_val);
+      }
+      return nb::cast(result);
+    }
+    // With out=, where= or dtype= a scalar behaves like a 0-D array
+    return dispatch_output_dtype(dtype, out, [&](auto output_type) {
+      using Out = typename decltype(output_type)::type;
+      OutputBuffer<Out> output(out, {});
+      WhereMask mask = make_where_mask(where, {});
+      StatsComputePhase phase(1);
+      if (WhereCursor(mask, 0).next()) {
+        output.data()[0] = static_cast<Out>(func(input_val));
+      } else if (!output.is_user_provided()) {
+        output.data()[0] = static_cast<Out>(MASKED_VALUE);
+      }
+      return output.result();
+    });
   }
+
+  // Collect the input values and the result shape; lists are unpacked into a column of doubles
+  Column input_column;
+  bool is_list = false;
+
   // 2. Check for Python list
-  else if (nb::isinstance<nb::list>(input)) {
+  if (nb::isinstance<nb::list>(input)) {
     nb::list py_list = nb::cast<nb::list>(input);
-    std::vector<double> results;
-    results.reserve(nb::len(py_list));
+    input_column.f64_storage.reserve(nb::len(py_list));
 
     for (nb::handle item : py_list) {
       if (!PyFloat_Check(item.ptr()) && !PyLong_Check(item.ptr())) {
         throw nb::type_error("List elements must be float or int.");
       }
-      double item_val = nb::cast<double>(item);
-      results.push_back(func(item_val));
+      input_column.f64_storage.push_back(nb::cast<double>(item));
     }
-    return nb::cast(results);
+    bind_storage(input_column, Column::Kind::Float64);
+    input_column.shape = {input_column.size};
+    input_column.strides = {1};
+    is_list = true;
   }
   // 3. Check for NumPy array
   else if (nb::isinstance<nb::ndarray<>>(input)) {
-    // Handle ndarray with arbitrary dimension
-    try {
-      // Cast the input to the ndarray of type double
-      // (const because the input data is read only)
-      auto input_array = nb::cast<nb::ndarray<const double>>(input);
-
-      if (!is_c_contiguous(input_array)) {
-        throw nb::value_error(
-            "NDArray must be C-contiguous. "
-            "Use numpy.ascontiguousarray(your_array) before passing it.");
-      }
-
-      // Size is the total number of elements in the array
-      size_t num_elements = input_array.size();
-
-      // The shape vector is later used to initialize the result ndarray
-      // It will have similar shape as input array
-      std::vector<size_t> result_shape(input_array.ndim());
-      for (size_t i = 0; i < input_array.ndim(); ++i) result_shape[i] = input_array.shape(i);
+    // Handle ndarray with arbitrary dimension, viewing the buffer in place in its own dtype
+    // (strided views included)
+    input_column = make_native_array_column(input);
+  }
+  // 4. Handle unsupported types
+  else {
+    throw nb::type_error("Input must be a float, int, list or NumPy array.");
+  }
 
-      // Get the pointer to the block of data to be mapped
-      const double* data_buffer = input_array.data();
+  // The result has the same shape as the input
+  BroadcastLayout layout = column_layout(input_column);
+  const std::vector<size_t>& result_shape = layout.shape;
 
-      // Initialize the vector that will store the result
-      // And map all the elements from the input with the given func
-      double* results = new double[num_elements];
-      for (size_t i = 0; i < num_elements; ++i) {
-        results[i] = func(data_buffer[i]);
-      }
+  // A list input gives a list result, unless the results were requested in an array
+  if (is_list && plain_call) {
+    std::vector<double> results(layout.size);
+    stats_allocation(results.size() * sizeof(double));
+    const double* values = input_column.f64_storage.data();
+    {
+      StatsComputePhase phase(layout.size);
+      nb::gil_scoped_release release;
+      parallel_for(layout.size, [&](size_t begin, size_t end) {
+        if (batch) {
+          batch(values + begin, results.data() + begin, end - begin);
+          return;
+        }
+        for (size_t i = begin; i < end; ++i) results[i] = func(values[i]);
+      });
+    }
+    return nb::cast(results);
+  }
 
-      // Create the result ndarray, with the mapped data and pass the according shape
-      nb::capsule owner(results, [](void* p) noexcept { delete[] (double*)p; });
-      auto result_array =
-          nb::ndarray<double, nb::numpy>(results, result_shape.size(), result_shape.data(), owner).cast();
-      return result_array;
+  return dispatch_output_dtype(dtype, out, [&](auto output_type) {
+    using Out = typename decltype(output_type)::type;
+    OutputBuffer<Out> output(out, result_shape);
+    WhereMask mask = make_where_mask(where, result_shape);
 
-    } catch (const nb::cast_error& e) {
-      throw nb::type_error("NumPy array dtype cannot be cast to double or input is not suitable.");
+    // Map all the elements from the input with the given func, in parallel and without the GIL
+    try {
+      StatsComputePhase phase(layout.size);
+      nb::gil_scoped_release release;
+      Out* results = output.data();
+      const bool fill_masked = !output.is_user_provided();
+      input_column.visit([&](const auto* data_buffer) {
+        parallel_for(layout.size, [&](size_t begin, size_t end) {
+          if (layout.flat) {
+            // Flat fast path: the input is read in output order (step 1), or is a single broadcast value (step 0)
+            const int64_t step = layout.flat_step[0];
+            if (batch && step == 1 && mask.all()) {
+              evaluate_batch(batch, data_buffer, results, begin, end);
+              return;
+            }
+            WhereCursor selected(mask, begin);
+            for (size_t i = begin; i < end; ++i) {
+              if (selected.next()) {
+                results[i] = static_cast<Out>(func(static_cast<double>(data_buffer[step * static_cast<int64_t>(i)])));
+              } else if (fill_masked) {
+                results[i] = static_cast<Out>(MASKED_VALUE);
+              }
+            }
+            return;
+          }
+          BroadcastIterator it(layout, begin);
+          WhereCursor selected(mask, begin);
+          for (size_t i = begin; i < end; ++i, it.next()) {
+            if (selected.next()) {
+              results[i] = static_cast<Out>(func(static_cast<double>(data_buffer[it.offsets()[0]])));
+            } else if (fill_masked) {
+              results[i] = static_cast<Out>(MASKED_VALUE);
+            }
+          }
+        });
+      });
     } catch (const std::exception& e) {
       throw std::runtime_error("Error processing NumPy array: " + std::string(e.what()));
     }
-  }
 
-  // 4. Handle unsupported types
-  throw nb::type_error("Input must be a float, int, list or NumPy array.");
+    return output.result();
+  });
 }
 
 #endif
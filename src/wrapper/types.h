@@ -1,12 +1,18 @@
 #ifndef WRAPPER_TYPES_H
 #define WRAPPER_TYPES_H
 
+#include <cstddef>
 #include <functional>
 #include <variant>
 #include <vector>
 
 // Define the type for the function to be wrapped.
+// Functions known at compile time can be wrapped with wrap_vectorized (vectorized.h) instead of MultiargumentFunc.
 using Func = std::function<double(double)>;
 using MultiargumentFunc = std::function<double(const std::vector<std::variant<double, int>>&)>;
 
+// Optional array kernel of a single-argument function: evaluates it on n contiguous doubles
+// (e.g. with SIMD instructions). It must give the same results as the scalar function.
+using BatchFunc = void (*)(const double* input, double* output, size_t n);
+
 #endif
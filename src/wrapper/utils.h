@@ -37,8 +37,8 @@ inline bool check_int_dtype(const nb::object& array) {
 //
 // For an array to be C-contiguous, the last stride must always be 1,
 // and each preceding stride must equal the product of all dimensions after it.
-template <typename T>
-inline bool is_c_contiguous(const nb::ndarray<T>& arr) {
+template <typename... Args>
+inline bool is_c_contiguous(const nb::ndarray<Args...>& arr) {
   if (arr.size() == 0) return true;
   size_t expected_stride = 1;
   for (int i = arr.ndim() - 1; i >= 0; --i) {
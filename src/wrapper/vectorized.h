@@ -0,0 +1,280 @@
+#ifndef WRAPPER_VECTORIZED_H
+#define WRAPPER_VECTORIZED_H
+
+#include <nanobind/nanobind.h>
+
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../runtime/stats.h"
+#include "../runtime/thread_pool.h"
+#include "broadcast.h"
+#include "column.h"
+#include "output.h"
+
+namespace nb = nanobind;
+
+/**
+ * Number of elements gathered into typed buffers before the wrapped function is called on them.
+ * The buffers live on the stack, so this bounds their size (a few kB per argument).
+ */
+constexpr size_t VECTORIZED_RUN = 256;
+
+/**
+ * Returns the element at the given offset of a column, converted to T.
+ */
+template <typename T>
+inline T column_value(const Column& column, int64_t offset) {
+  return column.visit([offset](const auto* elements) { return static_cast<T>(elements[offset]); });
+}
+
+/**
+ * Returns a Python float or int converted to T.
+ */
+template <typename T>
+inline T scalar_value(nb::handle argument) {
+  if (PyFloat_Check(argument.ptr())) return static_cast<T>(nb::cast<double>(argument));
+  return static_cast<T>(nb::cast<int64_t>(argument));
+}
+
+/**
+ * Copies all elements of a column, in C order of its shape, into a contiguous vector of T.
+ * Used to hand a column to C routines taking plain arrays.
+ */
+template <typename T>
+inline std::vector<T> gather_column(const Column& column) {
+  BroadcastLayout layout = column_layout(column);
+  std::vector<T> values(layout.size);
+  stats_allocation(values.size() * sizeof(T));
+  if (values.empty()) return values;
+  column.visit([&](const auto* elements) {
+    if (layout.flat) {
+      const int64_t step = layout.flat_step[0];
+      for (size_t i = 0; i < layout.size; ++i) values[i] = static_cast<T>(elements[step * static_cast<int64_t>(i)]);
+      return;
+    }
+    BroadcastIterator it(layout, 0);
+    for (size_t i = 0; i < layout.size; ++i, it.next()) values[i] = static_cast<T>(elements[it.offsets()[0]]);
+  });
+  return values;
+}
+
+/**
+ * Calls F on Python scalar arguments.
+ */
+template <auto F, typename... Args, size_t... K>
+inline double call_scalar(const std::vector<nb::object>& input, std::index_sequence<K...>) {
+  return F(scalar_value<Args>(input[K])...);
+}
+
+/**
+ * Copies the elements of column c for the output indices [begin, begin + n) into dst, converted to T.
+ *
+ * @param offsets  Element offsets of the column for each of the n output indices; only used when
+ *                 the layout is not flat (flat layouts are read directly).
+ */
+template <typename T>
+inline void gather_run(const Column& column, const BroadcastLayout& layout, size_t c, size_t begin, size_t n,
+                       const int64_t* offsets, T* dst) {
+  if (layout.flat && layout.flat_step[c] == 0) {
+    std::fill(dst, dst + n, column_value<T>(column, 0));
+    return;
+  }
+  column.visit([&](const auto* elements) {
+    if (layout.flat) {
+      const auto* src = elements + begin;
+      for (size_t j = 0; j < n; ++j) dst[j] = static_cast<T>(src[j]);
+    } else {
+      for (size_t j = 0; j < n; ++j) dst[j] = static_cast<T>(elements[offsets[j]]);
+    }
+  });
+}
+
+/**
+ * Evaluates F over the output indices [begin, end) of a layout, one run of VECTORIZED_RUN elements at a time:
+ * the arguments of a run are gathered into typed buffers, then F is called in a tight loop over them.
+ */
+template <auto F, typename... Args, typename Out, size_t... K>
+inline void evaluate_runs(const std::vector<Column>& columns, const BroadcastLayout& layout, Out* results,
+                          const WhereMask& mask, bool fill_masked, size_t begin, size_t end,
+                          std::index_sequence<K...>) {
+  std::tuple<std::array<Args, VECTORIZED_RUN>...> buffers;
+  std::array<std::array<int64_t, VECTORIZED_RUN>, sizeof...(Args)> offsets;
+  std::optional<BroadcastIterator> it;
+  if (!layout.flat) it.emplace(layout, begin);
+  WhereCursor selected(mask, begin);
+
+  for (size_t run = begin; run < end; run += VECTORIZED_RUN) {
+    size_t n = std::min(VECTORIZED_RUN, end - run);
+    if (it) {
+      for (size_t j = 0; j < n; ++j, it->next()) {
+        for (size_t c = 0; c < sizeof...(Args); ++c) offsets[c][j] = it->offsets()[c];
+      }
+    }
+    (gather_run(columns[K], layout, K, run, n, offsets[K].data(), std::get<K>(buffers).data()), ...);
+
+    Out* dst = results + run;
+    if (mask.all()) {
+      for (size_t j = 0; j < n; ++j) dst[j] = static_cast<Out>(F(std::get<K>(buffers)[j]...));
+    } else {
+      for (size_t j = 0; j < n; ++j) {
+        if (selected.next()) {
+          dst[j] = static_cast<Out>(F(std::get<K>(buffers)[j]...));
+        } else if (fill_masked) {
+          dst[j] = static_cast<Out>(MASKED_VALUE);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Evaluates F over a layout of typed columns into the `out`/`where`/`dtype`/`out_file` aware output, on the
+ * shared thread pool and without the GIL. Shared by wrap_vectorized and wrap_vectorized_cartesian_product.
+ */
+template <auto F, typename... Args>
+inline nb::object evaluate_vectorized(const std::vector<Column>& columns, const BroadcastLayout& layout,
+                                      const nb::object& out, const nb::object& where, const nb::object& dtype,
+                                      const nb::object& out_file = nb::none()) {
+  return dispatch_output_dtype(dtype, out, [&](auto output_type) {
+    using Out = typename decltype(output_type)::type;
+    OutputBuffer<Out> output(out, layout.shape, out_file);
+    WhereMask mask = make_where_mask(where, layout.shape);
+
+    try {
+      StatsComputePhase phase(layout.size);
+      nb::gil_scoped_release release;
+      Out* results = output.data();
+      const bool fill_masked = !output.is_user_provided();
+      output.fill_in_order(layout.size, 1, [&](size_t first, size_t last) {
+        parallel_for(last - first, [&](size_t begin, size_t end) {
+          evaluate_runs<F, Args...>(columns, layout, results, mask, fill_masked, first + begin, first + end,
+                                    std::index_sequence_for<Args...>{});
+        });
+      });
+    } catch (const std::exception& e) {
+      throw std::runtime_error("Error processing NumPy array: " + std::string(e.what()));
+    }
+
+    return output.result();
+  });
+}
+
+/**
+ * Wraps a C function whose signature is known at compile time to support vectorized or scalar inputs,
+ * with the same semantics as wrap_multiargument_function: the arguments are broadcast against each other
+ * following the NumPy rules, and a scalar is returned if all inputs were scalars.
+ *
+ * Usage: wrap_vectorized<&AT_max_electron_range_m, double, int, int>(arguments, out, where).
+ *
+ * Unlike wrap_multiargument_function, no std::function, std::variant or per-element vector is involved:
+ * the arguments are converted to Args... in typed stack buffers and F is called directly on them, so the
+ * inner loop is allocation-free and can be inlined and auto-vectorized by the compiler when F is visible.
+ * Input arrays are read in their own dtype (float32, float64 or integers) without conversion copies.
+ * wrap_multiargument_function remains available for callees only known at runtime.
+ *
+ * @tparam F     The function to evaluate, taking Args... and returning double.
+ * @tparam Args  The argument types of F; ints and floats are converted to them as with static_cast.
+ * @param input  One nb::object per argument (scalars, lists, or NumPy arrays).
+ * @param out    None, or a writable C-contiguous float64 ndarray of the result shape to store the results in.
+ * @param where  None, a bool, or a boolean array broadcastable to the result shape;
+ *               F is only evaluated where it is true.
+ * @param dtype  None, numpy.float64 or numpy.float32: the dtype of the result (see dispatch_output_dtype).
+ * @return       A Python float if all inputs are scalars, otherwise an ndarray of the broadcast shape
+ *               (or `out` if it was provided).
+ *
+ * @throws nb::type_error  If any input is not a float, int, list, or NumPy array.
+ * @throws nb::value_error If the input shapes cannot be broadcast together, `out` has the wrong shape,
+ *                         `where` does not broadcast to it, or `dtype` is not a supported result dtype.
+ * @throws std::invalid_argument If the number of inputs does not match the number of arguments of F.
+ */
+template <auto F, typename... Args>
+inline nb::object wrap_vectorized(const std::vector<nb::object>& input, const nb::object& out = nb::none(),
+                                  const nb::object& where = nb::none(), const nb::object& dtype = nb::none()) {
+  static_assert(std::is_invocable_r_v<double, decltype(F), Args...>, "F must be callable with Args...");
+  if (input.size() != sizeof...(Args)) {
+    throw std::invalid_argument("Expected " + std::to_string(sizeof...(Args)) + " arguments, got " +
+                                std::to_string(input.size()) + ".");
+  }
+
+  bool scalars_only = true;
+  for (const auto& argument : input) {
+    if (nb::isinstance<nb::list>(argument) || nb::isinstance<nb::ndarray<>>(argument)) {
+      scalars_only = false;
+    } else if (!nb::isinstance<nb::float_>(argument) && !nb::isinstance<nb::int_>(argument)) {
+      throw nb::type_error("Input must be a float, int, list, or NumPy array.");
+    }
+  }
+  if (scalars_only && out.is_none() && where.is_none() && dtype.is_none()) {
+    double result;
+    {
+      StatsComputePhase phase(1);
+      result = call_scalar<F, Args...>(input, std::index_sequence_for<Args...>{});
+    }
+    return nb::cast(result);
+  }
+
+  std::vector<Column> columns;
+  columns.reserve(input.size());
+  for (const auto& argument : input) columns.push_back(make_column(argument));
+
+  return evaluate_vectorized<F, Args...>(columns, broadcast_columns(columns), out, where, dtype);
+}
+
+/**
+ * Applies a C function whose signature is known at compile time to the cartesian product of its arguments,
+ * with the same semantics as wrap_cartesian_product_function and the typed inner loop of wrap_vectorized.
+ *
+ * @tparam F     The function to evaluate, taking Args... and returning double.
+ * @tparam Args  The argument types of F.
+ * @param input  One nb::object per argument (scalars, lists, or NumPy arrays).
+ * @param out    None, or a writable C-contiguous float64 ndarray of the output shape to store the results in.
+ * @param where  None, a bool, or a boolean array broadcastable to the output shape;
+ *               F is only evaluated where it is true.
+ * @param dtype  None, numpy.float64 or numpy.float32: the dtype of the result (see dispatch_output_dtype).
+ * @param out_file None, or the path of a .npy file to write the results into instead of memory (see OutputBuffer).
+ * @return       An ndarray whose shape is the concatenation of the argument shapes (or `out` if it was provided,
+ *               or the file opened as a read-only memory map).
+ *
+ * @throws nb::type_error  If any input is not a float, int, list, or NumPy array.
+ * @throws nb::value_error If `out` has the wrong shape,
+ *                         `where` does not broadcast to it, or `dtype` is not a supported result dtype.
+ * @throws std::invalid_argument If the number of inputs does not match the number of arguments of F.
+ */
+template <auto F, typename... Args>
+inline nb::object wrap_vectorized_cartesian_product(const std::vector<nb::object>& input,
+                                                    const nb::object& out = nb::none(),
+                                                    const nb::object& where = nb::none(),
+                                                    const nb::object& dtype = nb::none(),
+                                                    const nb::object& out_file = nb::none()) {
+  static_assert(std::is_invocable_r_v<double, decltype(F), Args...>, "F must be callable with Args...");
+  if (input.size() != sizeof...(Args)) {
+    throw std::invalid_argument("Expected " + std::to_string(sizeof...(Args)) + " arguments, got " +
+                                std::to_string(input.size()) + ".");
+  }
+
+  std::vector<Column> columns;
+  columns.reserve(input.size());
+  for (const auto& argument : input) columns.push_back(make_column(argument));
+
+  // Return empty np.array in case any of the inputs is empty
+  for (const auto& column : columns) {
+    if (column.size == 0) {
+      return dispatch_output_dtype(dtype, out, [&](auto output_type) {
+        OutputBuffer<typename decltype(output_type)::type> empty(out, {0}, out_file);
+        return empty.result();
+      });
+    }
+  }
+
+  return evaluate_vectorized<F, Args...>(columns, cartesian_layout(columns), out, where, dtype, out_file);
+}
+
+#endif
@@ -0,0 +1,64 @@
+import asyncio
+import concurrent.futures
+
+import numpy as np
+import pytest
+
+from pyamtrack.stopping import electron_range, electron_range_aio, electron_range_async
+
+
+def test_async_result():
+    """electron_range_async returns a future of the same result as electron_range."""
+    energies = np.linspace(1, 100, 100_000)
+    future = electron_range_async(energies, [1, 2], cartesian_product=True)
+    assert isinstance(future, concurrent.futures.Future)
+    assert np.array_equal(future.result(timeout=60), electron_range(energies, [1, 2], cartesian_product=True))
+    assert electron_range_async(100.0, material=2, model="butts_katz").result(timeout=60) == electron_range(
+        100.0, 2, "butts_katz"
+    )
+
+
+def test_async_out():
+    """Results are written into out, which is returned once the future is done."""
+    energies = np.linspace(1, 100, 1000)
+    out = np.empty(1000)
+    assert electron_range_async(energies, out=out).result(timeout=60) is out
+    assert np.array_equal(out, electron_range(energies))
+
+
+def test_async_exception():
+    """Exceptions of the call are set on the future."""
+    future = electron_range_async([1.0, 2.0], model="unknown")
+    with pytest.raises(ValueError, match="Unknown model name"):
+        future.result(timeout=60)
+    assert isinstance(future.exception(), ValueError)
+
+
+def test_async_concurrent_batches():
+    """Several independent batches can be in flight at once, inputs are kept alive until completion."""
+    futures = [electron_range_async(np.full(10_000, float(i + 1)), i % 3 + 1) for i in range(16)]
+    for i, future in enumerate(futures):
+        assert np.array_equal(future.result(timeout=60), electron_range(np.full(10_000, float(i + 1)), i % 3 + 1))
+
+
+def test_asyncio():
+    """electron_range_aio can be awaited while the event loop runs other coroutines."""
+    energies = np.linspace(1, 100, 1_000_000)
+
+    async def main():
+        ticks = 0
+
+        async def ticker():
+            nonlocal ticks
+            while True:
+                ticks += 1
+                await asyncio.sleep(0)
+
+        task = asyncio.create_task(ticker())
+        ranges = await electron_range_aio(energies, [1, 2, 3], [2, 7], cartesian_product=True)
+        task.cancel()
+        return ranges, ticks
+
+    ranges, ticks = asyncio.run(main())
+    assert np.array_equal(ranges, electron_range(energies, [1, 2, 3], [2, 7], cartesian_product=True))
+    assert ticks > 0
@@ -177,3 +177,78 @@ def test_with_scalar_input(size1, size2, size3):
             expected_shape += (s,)
 
     assert output.shape == expected_shape
+
+
+def test_mixed_int_float_list_input():
+    """Lists mixing ints and floats are evaluated the same way as the equivalent float array"""
+    energies = [900, 1000.5, 1100]
+    output_list = electron_range(energies, [1, 2], 7, cartesian_product=True)
+    output_array = electron_range(np.array(energies, dtype=float), np.array([1, 2]), 7, cartesian_product=True)
+
+    assert output_list.shape == (3, 2)
+    assert np.allclose(output_list, output_array)
+
+
+def test_non_numeric_list_input():
+    """Non-numeric list elements are rejected before any evaluation takes place"""
+    with pytest.raises(TypeError):
+        electron_range([1000.0, "1000"], 1, 7, cartesian_product=True)
+
+
+def test_large_product_matches_broadcasting():
+    """Products spanning several energy blocks and (material, model) pairs match the broadcast evaluation"""
+    energies = np.linspace(1, 1000, 2 * 10000)[::2]
+    materials = [1, 2, 5]
+    models = [2, 5, 7]
+
+    output = electron_range(energies, materials, models, cartesian_product=True)
+
+    expected = electron_range(
+        energies[:, np.newaxis, np.newaxis],
+        np.array(materials)[np.newaxis, :, np.newaxis],
+        np.array(models)[np.newaxis, np.newaxis, :],
+    )
+    assert output.shape == (10000, 3, 3)
+    assert np.allclose(output, expected, equal_nan=True)
+
+
+@pytest.mark.parametrize("mode", ["exact", "table"])
+def test_out_file(tmp_path, mode):
+    """Products written to a .npy file equal the in-memory result and are returned as a read-only memory map"""
+    energies = np.linspace(1, 1000, 1000)
+    path = tmp_path / "ranges.npy"
+
+    output = electron_range(energies, [1, 2, 5], [2, 7], cartesian_product=True, mode=mode, out_file=path)
+
+    expected = electron_range(energies, [1, 2, 5], [2, 7], cartesian_product=True, mode=mode)
+    assert isinstance(output, np.memmap)
+    assert not output.flags.writeable
+    assert np.array_equal(output, expected, equal_nan=True)
+    assert np.array_equal(np.load(path), expected, equal_nan=True)
+
+    path = tmp_path / "ranges_float32.npy"
+    electron_range(energies, 1, 7, cartesian_product=True, dtype=np.float32, out_file=str(path))
+    assert np.load(path).dtype == np.float32
+
+
+def test_out_file_spanning_several_flushes(tmp_path):
+    """Files larger than the writeback granularity are filled completely and in order"""
+    energies = np.linspace(1, 1000, 1000000)
+    output = electron_range(energies, [1, 2, 5], [2, 5, 7], cartesian_product=True, out_file=tmp_path / "large.npy")
+    expected = electron_range(energies, [1, 2, 5], [2, 5, 7], cartesian_product=True)
+    assert output.shape == (1000000, 3, 3)
+    assert np.array_equal(output, expected, equal_nan=True)
+
+
+def test_out_file_invalid(tmp_path):
+    """out_file needs a cartesian product, excludes out, and failed calls leave no file behind"""
+    path = tmp_path / "ranges.npy"
+    with pytest.raises(ValueError):
+        electron_range([1.0, 2.0], 1, 7, out_file=path)
+    with pytest.raises(ValueError):
+        electron_range([1.0, 2.0], 1, 7, cartesian_product=True, out=np.empty(2), out_file=path)
+    with pytest.raises(OSError):
+        electron_range([1.0, 2.0], 1, 7, cartesian_product=True, out_file=tmp_path / "missing" / "ranges.npy")
+    with pytest.raises(ValueError):
+        electron_range([1.0, 2.0], 1, 7, cartesian_product=True, where=np.ones(3, bool), out_file=path)
+    assert not path.exists()
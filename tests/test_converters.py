@@ -1,6 +1,11 @@
+import os
+import subprocess
+import sys
+
 import numpy as np
 import pytest
 
+import pyamtrack.converters
 from pyamtrack.converters import beta_from_energy, energy_from_beta
 
 
@@ -16,3 +21,55 @@ def test_energy_from_beta_single():
     beta = 0.5
     energy = energy_from_beta(beta)
     assert energy > 80.0, "Energy should be positive for valid beta"
+
+
+def ulp_distance(a, b):
+    """Distance between float64 arrays of values with the same sign, in units in the last place."""
+    a, b = np.asarray(a, dtype=np.float64), np.asarray(b, dtype=np.float64)
+    distance = np.abs(a.view(np.int64) - b.view(np.int64))
+    distance[a == b] = 0
+    distance[np.isnan(a) & np.isnan(b)] = 0
+    return distance
+
+
+@pytest.mark.parametrize(
+    "func, values",
+    [
+        (beta_from_energy, np.concatenate([np.geomspace(1e-6, 1e6, 20001), [0.0, -1.0, np.inf, np.nan]])),
+        (
+            energy_from_beta,
+            np.concatenate([np.linspace(0, 1, 20001), 1 - np.geomspace(1e-3, 1e-15, 999), [1.5, np.nan]]),
+        ),
+    ],
+)
+def test_simd_kernels_match_libamtrack(func, values):
+    """Arrays (evaluated with the SIMD kernels, if enabled) agree with libamtrack called on single values."""
+    max_ulp = pyamtrack.converters.simd_info()["max_ulp"]
+    expected = np.array([func(float(value)) for value in values])
+
+    assert np.all(ulp_distance(func(values), expected) <= max_ulp)
+    # Lengths which are not a multiple of the vector width leave a scalar tail
+    assert np.all(ulp_distance(func(values[:-3]), expected[:-3]) <= max_ulp)
+    assert np.all(ulp_distance(func(list(values[:1001])), expected[:1001]) <= max_ulp)
+
+
+def test_simd_level_from_environment():
+    """PYAMTRACK_SIMD=scalar disables the SIMD kernels."""
+    code = "import pyamtrack.converters as c; i = c.simd_info(); print(i['level'], i['beta_from_energy'])"
+    env = dict(os.environ, PYAMTRACK_SIMD="scalar")
+    result = subprocess.run([sys.executable, "-c", code], env=env, capture_output=True, text=True, check=True)
+    assert result.stdout.split() == ["scalar", "False"]
+
+    assert pyamtrack.converters.simd_info()["level"] in ("scalar", "sse2", "avx2", "avx512")
+    # The kernels use the constants of libamtrack, so none of them is rejected
+    assert pyamtrack.converters.simd_info()["rejected"] == []
+
+
+@pytest.mark.parametrize("func, value", [(beta_from_energy, 100.0), (energy_from_beta, 0.5)])
+def test_broadcast_scalar_view(func, value):
+    """A zero-stride view of a single value (numpy.broadcast_to) is read in place, without reading past it."""
+    values = np.broadcast_to(np.float64(value), (10000,))
+    result = func(values)
+    assert result.shape == (10000,)
+    assert np.all(result == func(value))
+    assert np.all(func(np.broadcast_to(np.array([value]), (100, 100))) == func(value))
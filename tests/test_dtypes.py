@@ -0,0 +1,62 @@
+import numpy as np
+import pytest
+
+from pyamtrack.converters import beta_from_energy, energy_from_beta
+from pyamtrack.stopping import electron_range
+
+input_dtypes = [np.float64, np.float32, np.int64, np.int32, np.int16, np.uint32, np.uint8]
+
+
+@pytest.mark.parametrize("dtype", input_dtypes)
+def test_input_dtypes(dtype):
+    """Arrays of any float or integer dtype give the same results as their float64 conversion."""
+    values = np.arange(1, 101).astype(dtype)
+
+    assert np.array_equal(beta_from_energy(values), beta_from_energy(values.astype(np.float64)))
+    assert np.array_equal(electron_range(values, 1), electron_range(values.astype(np.float64), 1))
+    assert np.array_equal(
+        electron_range(values, [1, 2], cartesian_product=True),
+        electron_range(values.astype(np.float64), [1, 2], cartesian_product=True),
+    )
+
+
+@pytest.mark.parametrize("dtype", [dtype for dtype in input_dtypes if np.issubdtype(dtype, np.integer)])
+def test_material_dtypes(dtype):
+    """Material ids are accepted from integer arrays of any width."""
+    materials = np.array([1, 2, 3], dtype=dtype)
+    assert np.array_equal(electron_range(100.0, materials), electron_range(100.0, [1, 2, 3]))
+
+
+def test_float32_output():
+    """dtype=np.float32 returns single precision results, rounded from the double precision ones."""
+    energies = np.linspace(10, 1000, 50, dtype=np.float32)
+
+    result = beta_from_energy(energies, dtype=np.float32)
+    assert result.dtype == np.float32
+    assert np.array_equal(result, beta_from_energy(energies).astype(np.float32))
+
+    result = energy_from_beta([0.1, 0.5], dtype="float32")
+    assert isinstance(result, np.ndarray) and result.dtype == np.float32
+
+    result = electron_range(energies, [1, 2], 7, cartesian_product=True, dtype=np.float32)
+    assert result.dtype == np.float32 and result.shape == (50, 2)
+
+    result = electron_range(100.0, 1, dtype=np.float32)
+    assert result.dtype == np.float32 and result.shape == ()
+
+
+def test_float32_out():
+    """A float32 out= array selects single precision results."""
+    energies = np.linspace(10, 1000, 50)
+    out = np.empty(50, dtype=np.float32)
+
+    assert electron_range(energies, 1, out=out) is out
+    assert np.array_equal(out, electron_range(energies, 1).astype(np.float32))
+
+    with pytest.raises(TypeError):
+        beta_from_energy(energies, out=out, dtype=np.float64)
+
+
+def test_invalid_dtype():
+    with pytest.raises(ValueError, match="dtype must be float64 or float32"):
+        beta_from_energy(np.linspace(10, 1000, 50), dtype=np.int32)
@@ -0,0 +1,85 @@
+import numpy as np
+import pytest
+
+from pyamtrack.stopping import electron_range, electron_range_iter
+
+
+def collect(iterator, n_energies, block_shape):
+    """Assemble the blocks of an iterator into the full result, checking that they are contiguous."""
+    result = np.empty((n_energies,) + block_shape)
+    position = 0
+    for index, block in iterator:
+        assert index.start == position
+        assert block.shape == (index.stop - index.start,) + block_shape
+        result[index] = block
+        position = index.stop
+    assert position == n_energies
+    return result
+
+
+@pytest.mark.parametrize("chunk_elements", [1, 7, 64, 2**20])
+def test_iter_matches_cartesian_product(chunk_elements):
+    """The blocks assemble into the result of electron_range with cartesian_product=True."""
+    energies = np.geomspace(1e-2, 1e3, 200)
+    materials = [1, 2, 3]
+    models = ["tabata", "butts_katz"]
+    expected = electron_range(energies, materials, models, cartesian_product=True)
+
+    result = collect(electron_range_iter(energies, materials, models, chunk_elements=chunk_elements), 200, (3, 2))
+    assert np.array_equal(result, expected, equal_nan=True)
+
+
+def test_iter_block_size():
+    """Blocks hold at most chunk_elements results, or a single energy when that is already more."""
+    energies = np.linspace(1, 100, 100)
+    for _, block in electron_range_iter(energies, [1, 2, 3], [5, 7], chunk_elements=25):
+        assert block.size <= 24
+    for _, block in electron_range_iter(energies, [1, 2, 3], [5, 7], chunk_elements=4):
+        assert block.shape == (1, 3, 2)
+
+
+def test_iter_chunked_input():
+    """Energies can be given as an iterable of chunks, which are read lazily."""
+    energies = np.linspace(1, 100, 1000)
+    expected = electron_range(energies, [1, 2], cartesian_product=True)
+
+    consumed = []
+
+    def chunks():
+        for chunk in np.array_split(energies, 10):
+            consumed.append(chunk.size)
+            yield chunk
+        yield []
+        yield 100.0
+        consumed.append(1)
+
+    iterator = electron_range_iter(chunks(), [1, 2], chunk_elements=64)
+    index, block = next(iterator)
+    assert consumed == [100]
+    assert np.array_equal(block, expected[index])
+
+    result = collect(electron_range_iter(chunks(), [1, 2], chunk_elements=64), 1001, (2,))
+    assert np.array_equal(result[:1000], expected)
+    assert np.array_equal(result[1000], electron_range(100.0, [1, 2], cartesian_product=True))
+
+
+def test_iter_options():
+    """dtype and mode are passed on to electron_range, multidimensional energies are flattened."""
+    energies = np.linspace(1, 100, 60).reshape(3, 4, 5)
+    blocks = list(electron_range_iter(energies, 1, dtype=np.float32, mode="table", chunk_elements=16))
+    assert all(block.dtype == np.float32 for _, block in blocks)
+    result = np.concatenate([block for _, block in blocks])
+    assert np.allclose(result, electron_range(energies.ravel(), 1), rtol=1e-5)
+
+
+def test_iter_invalid_arguments():
+    with pytest.raises(ValueError):
+        electron_range_iter([1.0, 2.0], chunk_elements=0)
+    with pytest.raises(ValueError):
+        electron_range_iter([1.0, 2.0], cartesian_product=False)
+    with pytest.raises(ValueError):
+        electron_range_iter([1.0, 2.0], mode="fast")
+    with pytest.raises(TypeError):
+        electron_range_iter(None)
+    with pytest.raises(TypeError):
+        next(electron_range_iter(iter(["a"])))
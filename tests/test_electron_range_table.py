@@ -0,0 +1,98 @@
+import numpy as np
+import pytest
+
+import pyamtrack.stopping
+from pyamtrack.stopping import electron_range
+
+
+@pytest.fixture(autouse=True)
+def empty_table_cache():
+    pyamtrack.stopping.clear_table_cache()
+    yield
+    pyamtrack.stopping.clear_table_cache()
+
+
+@pytest.mark.parametrize("model", pyamtrack.stopping.get_models())
+def test_table_error_bound(model):
+    """Interpolated ranges stay within the relative error bound of the table."""
+    info = pyamtrack.stopping.build_table(1, model, rtol=1e-6)
+    assert info["max_rel_error"] <= 1e-6
+
+    energies = np.random.uniform(1e-2, 1e3, 10000)
+    exact = electron_range(energies, 1, model)
+    table = electron_range(energies, 1, model, mode="table")
+
+    # The bound is verified on a grid inside every interval, allow some slack between the grid points
+    valid = np.isfinite(exact) & (exact > 0)
+    assert np.all(np.abs(table[valid] - exact[valid]) <= 2e-6 * exact[valid])
+
+
+def test_table_sorted_and_unsorted():
+    """Sorted and shuffled energies give the same interpolated ranges."""
+    energies = np.geomspace(1e-3, 1e4, 100000)
+    sorted_result = electron_range(energies, 1, "tabata", mode="table")
+
+    permutation = np.random.permutation(energies.size)
+    shuffled_result = electron_range(energies[permutation], 1, "tabata", mode="table")
+
+    assert np.array_equal(sorted_result[permutation], shuffled_result)
+
+
+def test_table_outside_of_range():
+    """Energies outside of the table, including zero and negative energies, are computed exactly."""
+    energies = np.array([0.0, 1e-5, 2e4, -1.0])
+    exact = electron_range(energies, 1, 7)
+    table = electron_range(energies, 1, 7, mode="table")
+    assert np.array_equal(table, exact, equal_nan=True)
+    assert electron_range(0, mode="table") == 0
+
+
+def test_table_arguments():
+    """Table mode supports broadcasting, cartesian products, out= and scalar calls like the exact mode."""
+    energies = np.linspace(1, 1000, 50)
+    exact = electron_range(energies[:, np.newaxis], [1, 2], [5, 7])
+    table = electron_range(energies[:, np.newaxis], [1, 2], [5, 7], mode="table")
+    assert table.shape == exact.shape
+    assert np.allclose(table, exact, rtol=1e-6)
+
+    table = electron_range(energies, [1, 2], [5, 7], cartesian_product=True, mode="table")
+    assert np.allclose(table, electron_range(energies, [1, 2], [5, 7], cartesian_product=True), rtol=1e-6)
+
+    out = np.empty(50)
+    assert electron_range(energies, mode="table", out=out) is out
+
+    assert isinstance(electron_range(100.0, mode="table"), float)
+
+
+def test_table_cache():
+    """Tables are built on first use, can be rebuilt with other options, and cleared."""
+    assert pyamtrack.stopping.table_cache_info() == []
+
+    electron_range(np.linspace(1, 1000, 10), [1, 2], 7, mode="table")
+    info = pyamtrack.stopping.table_cache_info()
+    assert sorted((table["material"], table["model"]) for table in info) == [(1, 7), (2, 7)]
+
+    # Only the pairs occurring in the broadcast output get a table, a cartesian product needs all of them
+    pyamtrack.stopping.clear_table_cache()
+    electron_range(np.linspace(1, 1000, 10)[:, np.newaxis], [1, 2], [5, 7], mode="table")
+    info = pyamtrack.stopping.table_cache_info()
+    assert sorted((table["material"], table["model"]) for table in info) == [(1, 5), (2, 7)]
+    electron_range(np.linspace(1, 1000, 10), [1, 2], [5, 7], cartesian_product=True, mode="table")
+    assert len(pyamtrack.stopping.table_cache_info()) == 4
+
+    pyamtrack.stopping.build_table(1, "tabata", rtol=1e-9)
+    info = {(table["material"], table["model"]): table for table in pyamtrack.stopping.table_cache_info()}
+    assert info[(1, 7)]["rtol"] == 1e-9
+    assert info[(1, 7)]["max_rel_error"] <= 1e-9
+
+    pyamtrack.stopping.clear_table_cache()
+    assert pyamtrack.stopping.table_cache_info() == []
+
+
+def test_table_invalid_arguments():
+    with pytest.raises(ValueError, match="mode"):
+        electron_range(100.0, mode="spline")
+    with pytest.raises(ValueError):
+        pyamtrack.stopping.build_table(1, 7, rtol=0)
+    with pytest.raises(ValueError):
+        pyamtrack.stopping.build_table(1, 7, energy_min_MeV=10, energy_max_MeV=1)
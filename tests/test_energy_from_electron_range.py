@@ -0,0 +1,104 @@
+import numpy as np
+import pytest
+
+import pyamtrack.stopping
+from pyamtrack.stopping import electron_range, energy_from_electron_range
+
+
+@pytest.fixture(autouse=True)
+def empty_table_cache():
+    pyamtrack.stopping.clear_table_cache()
+    yield
+    pyamtrack.stopping.clear_table_cache()
+
+
+@pytest.mark.parametrize("model", pyamtrack.stopping.get_models())
+def test_inverse_of_electron_range(model):
+    """The ranges of the solved energies are the given ranges."""
+    energies = np.geomspace(1e-2, 1e2, 1000)
+    ranges = electron_range(energies, 1, model)
+    ranges = ranges[np.isfinite(ranges) & (ranges > 0)]
+
+    solved = energy_from_electron_range(ranges, 1, model)
+    assert np.allclose(electron_range(solved, 1, model), ranges, rtol=1e-9, atol=0)
+
+
+def test_energies():
+    """Energies are recovered for sorted, shuffled and scalar ranges."""
+    energies = np.geomspace(1e-3, 1e3, 10000)
+    ranges = electron_range(energies, 1, "tabata")
+    assert np.allclose(energy_from_electron_range(ranges, 1, "tabata"), energies, rtol=1e-9, atol=0)
+
+    permutation = np.random.permutation(energies.size)
+    assert np.allclose(energy_from_electron_range(ranges[permutation]), energies[permutation], rtol=1e-9, atol=0)
+
+    energy = energy_from_electron_range(electron_range(10.0))
+    assert isinstance(energy, float)
+    assert energy == pytest.approx(10.0, rel=1e-9)
+    assert energy_from_electron_range(0.0) == 0.0
+
+
+def test_table_mode():
+    """Inverting the table gives energies within its error bound."""
+    energies = np.geomspace(1e-2, 1e3, 10000)
+    ranges = electron_range(energies, 1, "tabata")
+    table = energy_from_electron_range(ranges, 1, "tabata", mode="table")
+    assert np.allclose(table, energies, rtol=2e-6, atol=0)
+    assert len(pyamtrack.stopping.table_cache_info()) == 1
+
+    # Ranges beyond the table are solved exactly
+    outside = electron_range(np.array([5e-4, 5e4]), 1, "tabata")
+    assert np.allclose(energy_from_electron_range(outside, mode="table"), [5e-4, 5e4], rtol=1e-9)
+
+
+def test_argument_forms():
+    """Broadcasting, cartesian products, out and dtype behave as in electron_range."""
+    ranges = np.geomspace(1e-7, 1e-2, 50)
+    materials = [1, 2, 3]
+    models = ["tabata", "butts_katz"]
+
+    product = energy_from_electron_range(ranges, materials, models, cartesian_product=True)
+    assert product.shape == (50, 3, 2)
+    for j, material in enumerate(materials):
+        for k, model in enumerate(models):
+            expected = energy_from_electron_range(ranges, material, model)
+            assert np.allclose(product[:, j, k], expected, rtol=1e-10, atol=0, equal_nan=True)
+
+    broadcast = energy_from_electron_range(ranges[:, None], np.array([[1, 2, 3]]))
+    assert np.allclose(broadcast, product[:, :, 0], rtol=1e-10, atol=0, equal_nan=True)
+
+    out = np.empty(50, dtype=np.float32)
+    assert energy_from_electron_range(ranges, out=out) is out
+    assert np.allclose(out, product[:, 0, 0], rtol=1e-6, equal_nan=True)
+
+    where = ranges > 1e-4
+    masked = energy_from_electron_range(ranges, where=where)
+    assert np.all(np.isnan(masked[~where]))
+    assert np.allclose(masked[where], product[where, 0, 0], rtol=1e-10, atol=0, equal_nan=True)
+
+
+def test_errors_policy():
+    """Invalid ranges, materials and models follow the errors= policy of electron_range."""
+    ranges = np.array([1e-3, -1.0, np.nan, 1e-3])
+    energies, codes = energy_from_electron_range(ranges, [1, 1, 1, 9999], errors="mask")
+    assert np.isfinite(energies[0]) and np.all(np.isnan(energies[1:]))
+    assert codes.tolist() == [
+        0,
+        pyamtrack.stopping.ERROR_INVALID_RANGE,
+        pyamtrack.stopping.ERROR_INVALID_RANGE,
+        pyamtrack.stopping.ERROR_INVALID_MATERIAL,
+    ]
+
+    # By default unknown ids raise, while negative or NaN ranges give NaN
+    with pytest.raises(ValueError, match="Invalid material ID: 9999"):
+        energy_from_electron_range(ranges, [1, 1, 1, 9999])
+    with pytest.raises(ValueError, match="Invalid model ID"):
+        energy_from_electron_range(1e-3, 1, 99)
+    default = energy_from_electron_range(ranges)
+    assert default[0] == default[3] == energies[0] and np.isnan(default[1:3]).all()
+    assert np.isnan(energy_from_electron_range(-1.0))
+    with pytest.raises(ValueError, match="mode"):
+        energy_from_electron_range(1e-3, mode="fast")
+
+    # No energy of the solver reaches a range of a million kilometers
+    assert np.isnan(energy_from_electron_range(1e9))
@@ -0,0 +1,105 @@
+import os
+import sys
+import sysconfig
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+import numpy as np
+import pytest
+
+import pyamtrack
+from pyamtrack.converters import beta_from_energy
+from pyamtrack.stopping import electron_range
+
+# Free-threaded interpreter running without the GIL (it is re-enabled if an extension does not support it)
+FREE_THREADED = bool(sysconfig.get_config_var("Py_GIL_DISABLED")) and not sys._is_gil_enabled()
+NUM_PYTHON_THREADS = 8
+# Tests asserting on wall-clock times depend on the load of the machine, and only run if this is set
+TIMING_TESTS = os.environ.get("PYAMTRACK_TIMING_TESTS") == "1"
+
+
+@pytest.fixture
+def single_pool_thread():
+    """Fixture evaluating every call on its calling thread, then restoring the number of threads."""
+    num_threads = pyamtrack.get_num_threads()
+    pyamtrack.set_num_threads(1)
+    yield
+    pyamtrack.set_num_threads(num_threads)
+
+
+def workload(seed):
+    """A mix of calls exercising the material, particle and model lookups and the caches of the bindings."""
+    rng = np.random.default_rng(seed)
+    energies = rng.uniform(1, 1000, 2000)
+    materials = rng.choice(pyamtrack.materials.get_names()[:5], 2000).tolist()
+    return [
+        beta_from_energy(energies),
+        electron_range(energies, materials, "tabata"),
+        electron_range(energies, pyamtrack.materials.water_liquid, 7),
+        electron_range(energies[:100], [1, 2, 3], ["tabata", 7], cartesian_product=True),
+        electron_range(energies, 1, "tabata", mode="table"),
+        pyamtrack.materials.density_g_cm3(np.arange(1, 10)),
+        pyamtrack.particles.decode(["12C", "1H", "4He", "238U"])["Z"],
+        np.array([pyamtrack.materials.Material("Aluminum Oxide").id, pyamtrack.particles.Particle("O").Z]),
+    ]
+
+
+def test_concurrent_calls(single_pool_thread):
+    """Many Python threads calling pyamtrack at the same time get the same results as sequential calls."""
+    seeds = list(range(4 * NUM_PYTHON_THREADS))
+    expected = [workload(seed) for seed in seeds]
+    with ThreadPoolExecutor(NUM_PYTHON_THREADS) as executor:
+        results = list(executor.map(workload, seeds))
+    for result, reference in zip(results, expected):
+        for value, expected_value in zip(result, reference):
+            assert np.array_equal(value, expected_value)
+
+
+def test_concurrent_lazy_attributes():
+    """Concurrent first accesses to a module attribute all return the same object."""
+    name = next((name for name in pyamtrack.materials.get_names() if name not in vars(pyamtrack.materials)), None)
+    if name is None:
+        pytest.skip("all materials already accessed")
+    with ThreadPoolExecutor(NUM_PYTHON_THREADS) as executor:
+        objects = list(executor.map(lambda _: getattr(pyamtrack.materials, name), range(NUM_PYTHON_THREADS)))
+    assert all(obj is objects[0] for obj in objects)
+
+
+def test_shared_iterator():
+    """Blocks of an iterator shared by several threads are each yielded exactly once."""
+    energies = np.linspace(1, 100, 10_000)
+    iterator = pyamtrack.stopping.electron_range_iter(energies, [1, 2], chunk_elements=200)
+    with ThreadPoolExecutor(NUM_PYTHON_THREADS) as executor:
+        blocks = list(executor.map(lambda _: list(iterator), range(NUM_PYTHON_THREADS)))
+    result = np.full((energies.size, 2), np.nan)
+    for index, block in (item for thread_blocks in blocks for item in thread_blocks):
+        assert np.isnan(result[index]).all()
+        result[index] = block
+    assert np.array_equal(result, electron_range(energies, [1, 2], cartesian_product=True))
+
+
+@pytest.mark.skipif(not TIMING_TESTS, reason="timing test, set PYAMTRACK_TIMING_TESTS=1 to run it")
+@pytest.mark.skipif(not FREE_THREADED, reason="requires free-threaded Python with the GIL disabled")
+def test_threads_scale(single_pool_thread):
+    """On free-threaded Python, N threads calling pyamtrack have close to N times the throughput of one."""
+    num_threads = min(4, os.cpu_count() or 1)
+    if num_threads < 2:
+        pytest.skip("requires several CPU cores")
+    energies = np.random.uniform(1, 1000, 1000)
+    calls = 200
+
+    def run(_):
+        for _ in range(calls):
+            electron_range(energies, 1, "tabata")
+
+    def throughput(threads):
+        best = float("inf")
+        for _ in range(3):
+            start = time.perf_counter()
+            with ThreadPoolExecutor(threads) as executor:
+                list(executor.map(run, range(threads)))
+            best = min(best, time.perf_counter() - start)
+        return threads * calls / best
+
+    speedup = throughput(num_threads) / throughput(1)
+    assert speedup > 0.6 * num_threads
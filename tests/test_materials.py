@@ -1,3 +1,4 @@
+import numpy as np
 import pytest
 
 import pyamtrack
@@ -56,3 +57,83 @@ def test_via_object():
     assert material.id == 1
     assert material.name == "Water, Liquid"
     assert material.density_g_cm3 == 1.0
+
+
+def test_table():
+    table = pyamtrack.materials.table()
+    ids = pyamtrack.materials.get_ids()
+    assert list(table["id"]) == ids
+    assert list(table["name"]) == pyamtrack.materials.get_long_names()
+    for i, id in enumerate(ids):
+        material = pyamtrack.materials.Material(id)
+        for column in ("density_g_cm3", "I_eV", "alpha_g_cm2_MeV", "p_MeV", "m_g_cm2", "average_A", "average_Z"):
+            assert table[column][i] == getattr(material, column)
+        assert table["phase"][i] == material.phase
+
+
+def test_table_is_a_read_only_view():
+    density = pyamtrack.materials.table()["density_g_cm3"]
+    assert not density.flags.writeable
+    assert not density.flags.owndata
+    with pytest.raises(ValueError):
+        density[0] = 2.0
+
+
+def test_vectorized_accessors():
+    ids = np.array([[1, 2], [3, 1]])
+    density = pyamtrack.materials.density_g_cm3(ids)
+    assert density.shape == (2, 2)
+    assert density[0, 0] == pyamtrack.materials.water_liquid.density_g_cm3
+    assert density[1, 0] == pyamtrack.materials.Material(3).density_g_cm3
+
+    assert pyamtrack.materials.I_eV(1) == pyamtrack.materials.water_liquid.I_eV
+    assert pyamtrack.materials.average_Z(pyamtrack.materials.water_liquid) == pyamtrack.materials.water_liquid.average_Z
+    assert list(pyamtrack.materials.average_A([1, pyamtrack.materials.Material(2)])) == [
+        pyamtrack.materials.Material(1).average_A,
+        pyamtrack.materials.Material(2).average_A,
+    ]
+
+    voxels = np.random.choice(pyamtrack.materials.get_ids(), 1000000).astype(np.int32)
+    table = pyamtrack.materials.table()
+    rows = np.searchsorted(table["id"], voxels)
+    assert np.array_equal(pyamtrack.materials.density_g_cm3(voxels), table["density_g_cm3"][rows])
+
+
+def test_vectorized_accessors_invalid():
+    with pytest.raises(ValueError):
+        pyamtrack.materials.density_g_cm3(9999)
+    with pytest.raises(ValueError):
+        pyamtrack.materials.density_g_cm3(np.array([1, 9999]))
+    with pytest.raises(TypeError):
+        pyamtrack.materials.density_g_cm3(np.array([1.0, 2.0]))
+    with pytest.raises(TypeError):
+        pyamtrack.materials.density_g_cm3("water")
+
+
+def test_material_initialization_by_sanitized_name():
+    for id, name in zip(pyamtrack.materials.get_ids(), pyamtrack.materials.get_names()):
+        material = pyamtrack.materials.Material(name)
+        assert material.id == id
+        assert material.name == pyamtrack.materials.Material(id).name
+
+
+def test_lazy_attributes():
+    """Materials are created on first access, then the same object is returned"""
+    assert "water_liquid" in dir(pyamtrack.materials)
+    assert set(pyamtrack.materials.get_names()) <= set(dir(pyamtrack.materials))
+    assert pyamtrack.materials.aluminum_oxide is pyamtrack.materials.aluminum_oxide
+    assert pyamtrack.materials.aluminum_oxide.name == "Aluminum Oxide"
+    with pytest.raises(AttributeError):
+        pyamtrack.materials.unobtainium
+    assert not hasattr(pyamtrack.materials, "unobtainium")
+
+
+def test_module_names():
+    """The submodules have the same names whether they are built as separate extensions or into _core"""
+    import sys
+
+    for name in ("converters", "materials", "particles", "stopping"):
+        module = getattr(pyamtrack, name)
+        assert module.__name__ == f"pyamtrack.{name}"
+        assert sys.modules[f"pyamtrack.{name}"] is module
+    assert pyamtrack.materials.Material.__module__ == "pyamtrack.materials"
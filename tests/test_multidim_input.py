@@ -78,3 +78,37 @@ def test_multi_dim_array(func, min_val, max_val, dim):
 
     assert array.shape == whole_results.shape
     assert np.allclose(whole_results_from_partial, whole_results)
+
+
+strided_views = [
+    lambda a: a[::2],
+    lambda a: a[::-1],
+    lambda a: a.T,
+    lambda a: a[:, 1],
+    lambda a: np.asfortranarray(a),
+]
+
+
+@pytest.mark.parametrize("func, min_val, max_val", multidim_base_cases)
+@pytest.mark.parametrize("view", strided_views)
+def test_strided_array(func, min_val, max_val, view):
+    """Non-contiguous views are accepted and give the same results as their contiguous copies."""
+    array = view(np.random.uniform(low=min_val, high=max_val, size=(6, 4)))
+
+    result = func(array)
+
+    assert result.shape == array.shape
+    assert np.array_equal(result, func(np.ascontiguousarray(array)))
+
+
+@pytest.mark.parametrize("view", strided_views)
+def test_strided_array_multi_argument(view):
+    """Strided energies and materials are read in place, for element-wise and cartesian product calls."""
+    energies = view(np.random.uniform(low=1, high=1000, size=(6, 4)))
+    materials = np.array([[1, 2, 3, 5, 6, 7]]).T[::-1][: energies.shape[0]]
+
+    result = electron_range(energies, materials)
+    assert np.array_equal(result, electron_range(np.ascontiguousarray(energies), np.ascontiguousarray(materials)))
+
+    result = electron_range(energies, [1, 2], cartesian_product=True)
+    assert np.array_equal(result, electron_range(np.ascontiguousarray(energies), [1, 2], cartesian_product=True))
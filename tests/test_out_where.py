@@ -0,0 +1,106 @@
+import numpy as np
+import pytest
+
+from pyamtrack.converters import beta_from_energy, energy_from_beta
+from pyamtrack.stopping import electron_range
+
+single_argument_cases = [
+    (beta_from_energy, 1, 1000),
+    (energy_from_beta, 0.01, 0.99),
+]
+
+
+@pytest.mark.parametrize("func, min_val, max_val", single_argument_cases)
+def test_out_single_argument(func, min_val, max_val):
+    """Results written into out= match the freshly allocated results, and out itself is returned."""
+    values = np.random.uniform(min_val, max_val, (20, 5))
+    out = np.empty_like(values)
+
+    result = func(values, out=out)
+
+    assert result is out
+    assert np.array_equal(out, func(values))
+
+
+def test_out_multi_argument():
+    """electron_range writes into out= for element-wise and cartesian product calls."""
+    energies = np.linspace(10, 1000, 50)
+
+    out = np.empty(50)
+    assert electron_range(energies, 1, "tabata", out=out) is out
+    assert np.array_equal(out, electron_range(energies, 1, "tabata"))
+
+    out = np.empty((50, 2, 3))
+    assert electron_range(energies, [1, 2], [2, 3, 7], cartesian_product=True, out=out) is out
+    assert np.array_equal(out, electron_range(energies, [1, 2], [2, 3, 7], cartesian_product=True))
+
+
+def test_out_scalar():
+    """A scalar input writes into a 0-D out array."""
+    out = np.empty(())
+    assert beta_from_energy(100.0, out=out) is out
+    assert out[()] == beta_from_energy(100.0)
+
+
+def test_out_invalid():
+    """out= must be a float64 C-contiguous array of the result shape."""
+    energies = np.linspace(10, 1000, 50)
+    with pytest.raises(ValueError):
+        beta_from_energy(energies, out=np.empty(49))
+    with pytest.raises(TypeError):
+        beta_from_energy(energies, out=np.empty(50, dtype=np.int64))
+    with pytest.raises(TypeError):
+        beta_from_energy(energies, out=np.empty(100)[::2])
+    with pytest.raises(ValueError):
+        electron_range(energies, [1, 2], 7, cartesian_product=True, out=np.empty(100))
+
+
+def test_where():
+    """Masked elements keep their value in out=, and are NaN in newly allocated results."""
+    energies = np.linspace(10, 1000, 50)
+    mask = energies > 500
+
+    result = beta_from_energy(energies, where=mask)
+    assert np.array_equal(result[mask], beta_from_energy(energies[mask]))
+    assert np.all(np.isnan(result[~mask]))
+
+    out = np.full(50, -1.0)
+    electron_range(energies, 1, "tabata", out=out, where=mask)
+    assert np.array_equal(out[mask], electron_range(energies[mask], 1, "tabata"))
+    assert np.all(out[~mask] == -1.0)
+
+    out = np.full((50, 2), -1.0)
+    product_mask = np.zeros((50, 2), dtype=bool)
+    product_mask[:, 1] = True
+    electron_range(energies, [1, 2], 7, cartesian_product=True, out=out, where=product_mask)
+    assert np.all(out[:, 0] == -1.0)
+    assert np.array_equal(out[:, 1], electron_range(energies, 2, 7))
+
+
+def test_where_broadcast():
+    """A where= mask is broadcast to the result shape, like NumPy does."""
+    energies = np.linspace(10, 1000, 50)
+    mask = energies > 500
+
+    out = np.full((50, 2), -1.0)
+    electron_range(energies, [1, 2], 7, cartesian_product=True, out=out, where=mask[:, None])
+    assert np.all(out[~mask] == -1.0)
+    assert np.array_equal(out[mask], electron_range(energies[mask], [1, 2], 7, cartesian_product=True))
+
+    result = electron_range(energies, [1, 2], 7, cartesian_product=True, where=np.array([False, True]))
+    assert np.all(np.isnan(result[:, 0]))
+    assert np.array_equal(result[:, 1], electron_range(energies, 2, 7))
+
+    values = energies.reshape(5, 10)
+    columns = np.arange(10) % 3 == 0
+    result = beta_from_energy(values, where=columns)
+    assert np.array_equal(result[:, columns], beta_from_energy(values[:, columns]))
+    assert np.all(np.isnan(result[:, ~columns]))
+
+
+def test_where_invalid_shape():
+    """where= must broadcast to the result shape."""
+    with pytest.raises(ValueError, match="cannot be broadcast"):
+        beta_from_energy(np.linspace(10, 1000, 50), where=np.ones(10, dtype=bool))
+    with pytest.raises(ValueError, match="cannot be broadcast"):
+        beta_from_energy(np.linspace(10, 1000, 50), where=np.ones((2, 50), dtype=bool))
@@ -0,0 +1,94 @@
+import os
+
+import numpy as np
+import pytest
+
+from pyamtrack.converters import beta_from_energy
+from pyamtrack.parallel import map_sharded
+from pyamtrack.stopping import electron_range
+
+
+def interruptible_electron_range(energy, *, out):
+    """
+    electron_range, failing for energies above 60 MeV/u if PYAMTRACK_TEST_SHARDS is "fail", and writing -1
+    if it is "mark", to interrupt an evaluation and tell which shards are evaluated when resuming.
+    """
+    mode = os.environ.get("PYAMTRACK_TEST_SHARDS")
+    if mode == "fail" and np.max(energy) > 60.0:
+        raise ValueError("interrupted")
+    if mode == "mark":
+        out[...] = -1
+        return out
+    return electron_range(energy, out=out)
+
+
+def fill_marker(energy, *, out):
+    """Writes -1 into its shard."""
+    out[...] = -1
+    return out
+
+
+def test_map_sharded_broadcast():
+    """Broadcast arguments give the same results as a single call, the large ones shared with the workers."""
+    energies = np.geomspace(1, 1000, 100_000).reshape(1000, 100)
+    materials = [1, 2, 3, 5] * 25
+    result = map_sharded(electron_range, energies, materials, workers=2)
+    assert np.array_equal(result, electron_range(energies, materials))
+    assert np.array_equal(map_sharded(beta_from_energy, energies, workers=2, shards=3), beta_from_energy(energies))
+
+
+def test_map_sharded_cartesian_product():
+    """The cartesian product is sharded along the first argument, kwargs are passed to every shard."""
+    energies = np.geomspace(1, 1000, 20_000)
+    models = ["tabata", "butts_katz"]
+    result = map_sharded(
+        electron_range, energies, [1, 2, 3], models, cartesian_product=True, workers=2, dtype=np.float32
+    )
+    expected = electron_range(energies, [1, 2, 3], models, cartesian_product=True, dtype=np.float32)
+    assert result.shape == (20_000, 3, 2)
+    assert result.dtype == np.float32
+    assert np.array_equal(result, expected)
+
+
+def test_map_sharded_small_inputs():
+    """Fewer rows than workers, a single row and empty inputs are handled."""
+    assert np.array_equal(map_sharded(electron_range, [10.0, 20.0], workers=4), electron_range([10.0, 20.0]))
+    assert map_sharded(electron_range, np.array(10.0), workers=2) == electron_range(10.0)
+    assert map_sharded(electron_range, np.empty(0), workers=2).shape == (0,)
+
+
+def test_map_sharded_invalid_arguments():
+    with pytest.raises(ValueError, match="broadcast"):
+        map_sharded(electron_range, np.ones(3), [1, 2], workers=1)
+    with pytest.raises(ValueError, match="out cannot be given"):
+        map_sharded(electron_range, np.ones(3), out=np.empty(3), workers=1)
+    with pytest.raises(ValueError, match="mask"):
+        map_sharded(electron_range, np.ones(3), errors="mask", workers=1)
+
+
+def test_map_sharded_resume(monkeypatch):
+    """An interrupted evaluation keeps its completed shards in the named block, only the others are resumed."""
+    name = f"pyamtrack_test_{os.getpid()}"
+    energies = np.linspace(1, 100, 1000)
+    monkeypatch.setenv("PYAMTRACK_TEST_SHARDS", "fail")
+    with pytest.raises(ValueError, match="interrupted"):
+        map_sharded(interruptible_electron_range, energies, workers=2, shards=4, name=name)
+
+    # The block is only resumed by the same call: function, shape, dtype and arguments
+    for args, kwargs in [
+        ((fill_marker, energies), {}),
+        ((interruptible_electron_range, energies[:10]), {}),
+        ((interruptible_electron_range, energies.astype(np.float32)), {}),
+        ((interruptible_electron_range, energies), {"dtype": np.float32}),
+        ((interruptible_electron_range, energies), {"shards": 5}),
+    ]:
+        with pytest.raises(ValueError, match="does not hold the output"):
+            map_sharded(*args, workers=2, name=name, **kwargs)
+
+    monkeypatch.setenv("PYAMTRACK_TEST_SHARDS", "mark")
+    result = map_sharded(interruptible_electron_range, energies, workers=2, name=name)
+    assert np.array_equal(result[:500], electron_range(energies[:500]))
+    assert np.all(result[500:] == -1)
+
+    # The completed evaluation removed the block
+    assert np.all(map_sharded(interruptible_electron_range, energies, workers=2, name=name) == -1)
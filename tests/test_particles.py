@@ -1,3 +1,4 @@
+import numpy as np
 import pytest
 
 import pyamtrack
@@ -107,3 +108,59 @@ def test_via_acronym_object():
     assert particle.id == 2
     assert particle.element_name == "Helium"
     assert particle.element_acronym == "He"
+
+
+def test_decode_numbers():
+    numbers = np.array([[1001, 2004], [6012, 8016]])
+    decoded = pyamtrack.particles.decode(numbers)
+    assert decoded["Z"].shape == (2, 2)
+    assert decoded["Z"].tolist() == [[1, 2], [6, 8]]
+    assert decoded["A"].tolist() == [[1, 4], [12, 16]]
+    for number, weight in zip(numbers.ravel(), decoded["atomic_weight"].ravel()):
+        assert weight == pyamtrack.particles.Particle.from_number(int(number)).atomic_weight
+
+    decoded = pyamtrack.particles.decode([6012, 6014])
+    assert decoded["Z"].tolist() == [6, 6]
+    assert decoded["A"].tolist() == [12, 14]
+
+
+def test_decode_large_array():
+    numbers = np.random.choice([1001, 2004, 6012, 8016], 1000000).astype(np.int32)
+    decoded = pyamtrack.particles.decode(numbers)
+    assert np.array_equal(decoded["Z"], numbers // 1000)
+    assert np.array_equal(decoded["A"], numbers % 1000)
+
+
+def test_decode_strings():
+    names = ["12C", "4He", "O", "238U"]
+    decoded = pyamtrack.particles.decode(names)
+    assert decoded["Z"].tolist() == [6, 2, 8, 92]
+    assert decoded["A"].tolist() == [12, 4, -1, 238]
+    assert decoded["atomic_weight"][0] == pyamtrack.particles.Particle("C").atomic_weight
+
+    decoded = pyamtrack.particles.decode(np.array(names).reshape(2, 2))
+    assert decoded["Z"].tolist() == [[6, 2], [8, 92]]
+
+
+def test_decode_invalid():
+    with pytest.raises(ValueError):
+        pyamtrack.particles.decode(np.array([6012, 999999]))
+    with pytest.raises(ValueError):
+        pyamtrack.particles.decode(["12C", "Xyz123"])
+    with pytest.raises(ValueError):
+        pyamtrack.particles.decode(["12"])
+    with pytest.raises(TypeError):
+        pyamtrack.particles.decode(np.array([6012.0]))
+    with pytest.raises(TypeError):
+        pyamtrack.particles.decode(["12C", 6012])
+    with pytest.raises(TypeError):
+        pyamtrack.particles.decode(6012)
+
+
+def test_lazy_attributes():
+    """Particles are created on first access by name or acronym, then the same object is returned"""
+    assert {"Carbon", "C"} <= set(dir(pyamtrack.particles))
+    assert pyamtrack.particles.Carbon is pyamtrack.particles.Carbon
+    assert pyamtrack.particles.C.Z == pyamtrack.particles.Carbon.Z == 6
+    with pytest.raises(AttributeError):
+        pyamtrack.particles.Unobtainium
@@ -0,0 +1,59 @@
+import numpy as np
+import pytest
+
+import pyamtrack
+from pyamtrack.converters import beta_from_energy
+from pyamtrack.stopping import electron_range
+
+
+@pytest.fixture
+def collect_stats():
+    """Fixture collecting statistics from a clean state during the test."""
+    enabled = pyamtrack.stats_enabled()
+    pyamtrack.reset_stats()
+    pyamtrack.enable_stats()
+    yield
+    pyamtrack.enable_stats(enabled)
+    pyamtrack.reset_stats()
+
+
+def test_stats_disabled():
+    """Nothing is recorded while the statistics are disabled."""
+    enabled = pyamtrack.stats_enabled()
+    pyamtrack.enable_stats(False)
+    pyamtrack.reset_stats()
+    beta_from_energy(np.linspace(1, 100, 10))
+    assert pyamtrack.stats() == {}
+    pyamtrack.enable_stats(enabled)
+
+
+def test_stats_calls_and_elements(collect_stats):
+    """Calls, computed elements and allocated bytes are counted per function."""
+    energies = np.linspace(1, 1000, 1000)
+    beta_from_energy(energies)
+    beta_from_energy(100.0)
+    electron_range(energies, [1, 2], cartesian_product=True)
+
+    stats = pyamtrack.stats()
+    assert stats["converters.beta_from_energy"]["calls"] == 2
+    assert stats["converters.beta_from_energy"]["elements"] == 1001
+    assert stats["converters.beta_from_energy"]["allocated_bytes"] >= 1000 * 8
+    assert stats["stopping.electron_range"]["calls"] == 1
+    assert stats["stopping.electron_range"]["elements"] == 2000
+
+    for entry in stats.values():
+        for phase in ("parse_seconds", "compute_seconds", "result_seconds"):
+            assert entry[phase] >= 0
+
+    pyamtrack.reset_stats()
+    assert pyamtrack.stats() == {}
+
+
+def test_stats_failed_call(collect_stats):
+    """Calls raising an exception are counted, without computed elements."""
+    with pytest.raises(TypeError):
+        beta_from_energy("abc")
+    assert pyamtrack.stats()["converters.beta_from_energy"] == pytest.approx(
+        {"calls": 1, "elements": 0, "parse_seconds": 0, "compute_seconds": 0, "result_seconds": 0, "allocated_bytes": 0},
+        abs=1e-3,
+    )
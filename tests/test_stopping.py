@@ -48,6 +48,31 @@ def test_mixed_parameter_types(electron_energy_MeV):
     assert isinstance(range_many_materials_and_methods, np.ndarray) and range_many_materials_and_methods.shape == (3,)
 
 
+def test_categorical_ids():
+    """Lists and NumPy str/object arrays of names, ids and Material objects resolve like the matching int ids"""
+    energies = np.linspace(1, 100, 6)
+    water = pyamtrack.materials.water_liquid
+    expected = pyamtrack.stopping.electron_range(energies, [1, 1, 2, 1, 2, 1], [7, 2, 7, 7, 2, 7])
+
+    models = np.array(["tabata", "butts_katz", "tabata", "tabata", "butts_katz", "tabata"])
+    materials = np.array([water, 1, pyamtrack.materials.Material(2), water, np.int64(2), 1], dtype=object)
+    assert np.array_equal(pyamtrack.stopping.electron_range(energies, materials, models), expected)
+    assert np.array_equal(pyamtrack.stopping.electron_range(energies, list(materials), list(models)), expected)
+    assert np.array_equal(
+        pyamtrack.stopping.electron_range(energies, 1, np.array(["tabata", 2, "tabata"] * 2, dtype=object)),
+        pyamtrack.stopping.electron_range(energies, 1, [7, 2, 7] * 2),
+    )
+
+    # Shapes of the arrays are kept
+    ranges = pyamtrack.stopping.electron_range(100.0, 1, models.reshape(2, 3))
+    assert ranges.shape == (2, 3)
+
+    with pytest.raises(ValueError):
+        pyamtrack.stopping.electron_range(energies, 1, np.array(["tabata", "unknown"] * 3))
+    with pytest.raises(TypeError):
+        pyamtrack.stopping.electron_range(energies, 1, np.array([7.0, 2.0] * 3))
+
+
 @pytest.mark.parametrize(
     "dtype1, dtype2",
     [
@@ -98,8 +123,103 @@ def test_material_assignment_invalid(electron_energy_MeV):
         pyamtrack.stopping.electron_range(electron_energy_MeV, pyamtrack.materials.get_ids)
 
 
-@pytest.mark.skip
 def test_invalid_id(electron_energy_MeV):
     """Test the electron_range function with an invalid ID."""
     with pytest.raises(ValueError, match="Invalid material ID"):
         pyamtrack.stopping.electron_range(electron_energy_MeV, 1000000)
+    assert np.isnan(pyamtrack.stopping.electron_range(electron_energy_MeV, 1000000, errors="nan"))
+
+
+def test_errors_policy():
+    """Invalid elements give NaN, a ValueError or an error code, without affecting the valid ones."""
+    stopping = pyamtrack.stopping
+    energies = np.array([10.0, -1.0, 20.0, np.nan, 30.0])
+    materials = np.array([1, 1, 1000000, 1, 2])
+    models = np.array([7, 7, 7, 7, 99])
+    valid = np.array([True, False, False, False, False])
+    expected = stopping.electron_range(energies[0], 1, 7)
+
+    result = stopping.electron_range(energies, materials, models, errors="nan")
+    assert result[0] == expected and np.isnan(result[1:]).all()
+
+    result, codes = stopping.electron_range(energies, materials, models, errors="mask")
+    assert codes.dtype == np.uint8
+    assert codes.tolist() == [
+        0,
+        stopping.ERROR_INVALID_ENERGY,
+        stopping.ERROR_INVALID_MATERIAL,
+        stopping.ERROR_INVALID_ENERGY,
+        stopping.ERROR_INVALID_MODEL,
+    ]
+    assert np.array_equal(result, stopping.electron_range(energies, materials, models, errors="nan"), equal_nan=True)
+
+    # By default unknown ids raise, while negative or NaN energies give NaN
+    with pytest.raises(ValueError, match="Invalid material ID: 1000000 \\(element 2 "):
+        stopping.electron_range(energies, materials, models)
+    with pytest.raises(ValueError, match="Invalid model ID: 99"):
+        stopping.electron_range(energies, 1, models, errors="raise")
+    result = stopping.electron_range(energies)
+    assert result[0] == expected and np.isnan(result[[1, 3]]).all()
+    with pytest.raises(ValueError, match="errors must be"):
+        stopping.electron_range(energies, errors="ignore")
+
+    # Elements excluded by where are not checked, invalid elements are overwritten in out
+    out = np.zeros(5)
+    stopping.electron_range(energies, materials, models, out=out, where=[True, True, False, False, False])
+    assert out[0] == expected and np.isnan(out[1]) and (out[2:] == 0).all()
+    stopping.electron_range(energies, materials, models, where=valid, errors="raise")
+
+    # Valid calls return all-zero codes, scalars a single code
+    _, codes = stopping.electron_range(energies[valid], errors="mask")
+    assert codes.tolist() == [0]
+    assert stopping.electron_range(-1.0, errors="mask")[1] == stopping.ERROR_INVALID_ENERGY
+
+
+@pytest.mark.parametrize("mode", ["exact", "table"])
+def test_errors_policy_cartesian_product(mode):
+    """Invalid materials and models of a cartesian product only invalidate their own slices."""
+    stopping = pyamtrack.stopping
+    energies = np.array([1.0, 10.0, -5.0])
+    result, codes = stopping.electron_range(
+        energies, [1, 1000000], [7, 99], cartesian_product=True, mode=mode, errors="mask"
+    )
+    assert result.shape == codes.shape == (3, 2, 2)
+    assert np.array_equal(result[:2, 0, 0], stopping.electron_range(energies[:2], 1, 7, mode=mode))
+    assert np.isnan(result[2]).all() and np.isnan(result[:, 1]).all() and np.isnan(result[:, :, 1]).all()
+    assert (codes[2] == stopping.ERROR_INVALID_ENERGY).all()
+    assert (codes[:2, 1, :] == stopping.ERROR_INVALID_MATERIAL).all()
+    assert (codes[:2, 0, 1] == stopping.ERROR_INVALID_MODEL).all()
+
+
+def test_broadcasting():
+    """Energy, material and model are broadcast against each other following the NumPy rules."""
+    energies = np.linspace(10, 1000, 4).reshape(4, 1)
+    materials = np.array([[1, 2, 3]])
+
+    result = pyamtrack.stopping.electron_range(energies, materials, [2, 5, 7])
+
+    assert result.shape == (4, 3)
+    for i in range(4):
+        for j in range(3):
+            expected = pyamtrack.stopping.electron_range(float(energies[i, 0]), int(materials[0, j]), [2, 5, 7][j])
+            assert result[i, j] == expected
+
+
+def test_broadcasting_incompatible_shapes():
+    energies = np.linspace(10, 1000, 4)
+    with pytest.raises(ValueError, match="could not be broadcast"):
+        pyamtrack.stopping.electron_range(energies, [1, 2, 3])
+
+
+def test_large_input_matches_scalar_calls():
+    """Inputs spanning several evaluation runs, with and without broadcasting, match scalar evaluation."""
+    energies = np.linspace(1, 1000, 1000)
+    materials = np.array([1, 2, 3, 5, 6, 7])[:, np.newaxis]
+
+    result = pyamtrack.stopping.electron_range(energies[::-1], materials)
+
+    assert result.shape == (6, 1000)
+    for i in [0, 3, 5]:
+        for j in [0, 255, 256, 511, 999]:
+            expected = pyamtrack.stopping.electron_range(float(energies[999 - j]), int(materials[i, 0]))
+            assert result[i, j] == expected
@@ -0,0 +1,46 @@
+import numpy as np
+import pytest
+
+import pyamtrack
+from pyamtrack.converters import beta_from_energy
+from pyamtrack.stopping import electron_range
+
+
+@pytest.fixture
+def restore_num_threads():
+    """Fixture restoring the number of threads after the test."""
+    num_threads = pyamtrack.get_num_threads()
+    yield
+    pyamtrack.set_num_threads(num_threads)
+
+
+def test_set_num_threads(restore_num_threads):
+    """Test that the number of threads can be changed and read back."""
+    pyamtrack.set_num_threads(3)
+    assert pyamtrack.get_num_threads() == 3
+    pyamtrack.set_num_threads(0)
+    assert pyamtrack.get_num_threads() >= 1
+
+
+def test_set_num_threads_invalid(restore_num_threads):
+    """Test that a negative number of threads is rejected."""
+    with pytest.raises(ValueError):
+        pyamtrack.set_num_threads(-1)
+
+
+@pytest.mark.parametrize("num_threads", [1, 2, 4])
+def test_results_independent_of_num_threads(restore_num_threads, num_threads):
+    """Test that large inputs give the same results regardless of the number of threads."""
+    energies = np.random.uniform(1, 1000, 100_000)
+    materials = np.random.randint(1, 5, 100_000)
+
+    pyamtrack.set_num_threads(1)
+    expected_beta = beta_from_energy(energies)
+    expected_range = electron_range(energies, materials, "tabata")
+    expected_product = electron_range(energies[:1000], [1, 2, 3], [2, 7], cartesian_product=True)
+
+    pyamtrack.set_num_threads(num_threads)
+    assert np.array_equal(beta_from_energy(energies), expected_beta)
+    assert np.array_equal(beta_from_energy(energies.tolist()), expected_beta.tolist())
+    assert np.array_equal(electron_range(energies, materials, "tabata"), expected_range)
+    assert np.array_equal(electron_range(energies[:1000], [1, 2, 3], [2, 7], cartesian_product=True), expected_product)